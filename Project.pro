@@ -16,11 +16,22 @@ SOURCES += \
     src/client.cpp \
     src/explorer.cpp \
     src/simulator.cpp \
+    src/snapshot.cpp \
+    src/history_store.cpp \
+    src/payload_cache.cpp \
+    src/topic_rate.cpp \
+    src/thumbnail_cache.cpp \
+    src/search_index.cpp \
+    src/json_path.cpp \
+    src/payload_viewer.cpp \
     src/widgets/widget.cpp \
     src/widgets/thermostat/thermostat.cpp \
     src/widgets/lcd_display/lcd_display.cpp \
     src/widgets/light_switch/light_switch.cpp \
+    src/widgets/security_camera/frame_history.cpp \
+    src/widgets/security_camera/frame_pipeline.cpp \
     src/widgets/security_camera/security_camera.cpp \
+    src/widgets/chart/chart.cpp \
     src/extensions/FlowLayout.cpp 
 
 HEADERS += \
@@ -28,11 +39,22 @@ HEADERS += \
     src/client.h \
     src/explorer.h \
     src/simulator.h \
+    src/snapshot.h \
+    src/history_store.h \
+    src/payload_cache.h \
+    src/topic_rate.h \
+    src/thumbnail_cache.h \
+    src/search_index.h \
+    src/json_path.h \
+    src/payload_viewer.h \
     src/widgets/widget.h \
     src/widgets/thermostat/thermostat.h \
     src/widgets/lcd_display/lcd_display.h \
     src/widgets/light_switch/light_switch.h \
+    src/widgets/security_camera/frame_history.h \
+    src/widgets/security_camera/frame_pipeline.h \
     src/widgets/security_camera/security_camera.h \
+    src/widgets/chart/chart.h \
     src/extensions/FlowLayout.h
 
 FORMS += \
@@ -46,6 +68,8 @@ FORMS += \
     src/widgets/security_camera/security_camera.ui \
     src/widgets/security_camera/security_camera_settings.ui \
     src/widgets/thermostat/thermostat.ui \
-    src/widgets/thermostat/thermostat_settings.ui
+    src/widgets/thermostat/thermostat_settings.ui \
+    src/widgets/chart/chart.ui \
+    src/widgets/chart/chart_settings.ui
 
 RESOURCES += Resources.qrc
\ No newline at end of file
@@ -7,12 +7,15 @@
 
 #include "client.h"
 
+#include <algorithm>
+
+#include <QMap>
 #include <QUuid>
 #include <QObject>
 #include <QString>
 #include <QPixmap> 
-#include <QVariant>
 #include <QByteArray>
+#include <QMetaObject>
 
 #include "utils.h"
 
@@ -23,126 +26,468 @@ Client::Client(QObject *parent) : QObject(parent)
         .clean_start(false)
         .connect_timeout(std::chrono::milliseconds(5000))
         .finalize();
+
+    // Connect callbacks come from Paho thread, attempt number is passed as user context
+    connectListener.success = [this](const mqtt::token& token) {
+        auto attempt = static_cast<quint64>(reinterpret_cast<quintptr>(token.get_user_context()));
+        QMetaObject::invokeMethod(this, [this, attempt]() { onConnectCompleted(attempt, true); }, Qt::QueuedConnection);
+    };
+    connectListener.failure = [this](const mqtt::token& token) {
+        auto attempt = static_cast<quint64>(reinterpret_cast<quintptr>(token.get_user_context()));
+        QMetaObject::invokeMethod(this, [this, attempt]() { onConnectCompleted(attempt, false); }, Qt::QueuedConnection);
+    };
+
+    reconnectTimer.setSingleShot(true);
+    QObject::connect(&reconnectTimer, &QTimer::timeout, this, &Client::onReconnectTimeout);
+
+    // Delivery callbacks come from Paho thread, publish identifier is passed as user context
+    // Completion is processed in the thread of Client so the inflight window does not need locking
+    deliveryListener.success = [this](const mqtt::token& token) {
+        auto id = static_cast<quint64>(reinterpret_cast<quintptr>(token.get_user_context()));
+        QMetaObject::invokeMethod(this, [this, id]() { onPublishCompleted(id, true); }, Qt::QueuedConnection);
+    };
+    deliveryListener.failure = [this](const mqtt::token& token) {
+        auto id = static_cast<quint64>(reinterpret_cast<quintptr>(token.get_user_context()));
+        QMetaObject::invokeMethod(this, [this, id]() { onPublishCompleted(id, false); }, Qt::QueuedConnection);
+    };
+
+    // Subscribe callbacks come from Paho thread, packet identifier is passed as user context
+    // With MQTT 3.1.1 SUBACK of many topics is reported as success even when some of them were rejected,
+    // so the return code of every topic is passed along
+    subscribeListener.success = [this](const mqtt::token& token) {
+        auto id = static_cast<quint64>(reinterpret_cast<quintptr>(token.get_user_context()));
+        QVector<int> codes;
+
+        try
+        {
+            for(auto code : token.get_subscribe_response().get_reason_codes())
+                codes.append(static_cast<int>(code));
+        }
+        catch(...) {}
+
+        QMetaObject::invokeMethod(this, [this, id, codes]() { onSubscribeCompleted(id, true, codes); }, Qt::QueuedConnection);
+    };
+    subscribeListener.failure = [this](const mqtt::token& token) {
+        auto id = static_cast<quint64>(reinterpret_cast<quintptr>(token.get_user_context()));
+        QMetaObject::invokeMethod(this, [this, id]() { onSubscribeCompleted(id, false, QVector<int>()); }, Qt::QueuedConnection);
+    };
 }
 
 bool Client::connect(QString address)
 {
-    if(connected)
+    if(state != ConnectionState::Disconnected)
         return false;
 
+    // Client instance of previous failed attempt may still exist
+    delete connection;
+    connection = Q_NULLPTR;
+
     // Create client instance with unique ID
-    connection = new mqtt::async_client(address.toStdString(), QUuid::createUuid().toString().toStdString(), mqtt::create_options(MQTTVERSION_5));
+    try
+    {
+        connection = new mqtt::async_client(address.toStdString(), QUuid::createUuid().toString().toStdString(), mqtt::create_options(MQTTVERSION_5));
+    }
+    catch(...)
+    {
+        return false;
+    }
     
     // Register callbacks
     connection->set_disconnected_handler(std::bind(&Client::onDisconnected, this, std::placeholders::_1, std::placeholders::_2));
     connection->set_connection_lost_handler(std::bind(&Client::onConnectionLost, this, std::placeholders::_1));
     connection->set_message_callback(std::bind(&Client::onMessageReceived, this, std::placeholders::_1));
 
+    state = ConnectionState::Connecting;
+    reconnectDelay = minReconnectDelay;
+
+    if(!startConnectAttempt())
+    {
+        state = ConnectionState::Disconnected;
+        return false;
+    }
+
+    return true;
+}
+
+bool Client::startConnectAttempt()
+{
     try 
     {
-        connection->connect(options)->wait();
+        connection->connect(options, reinterpret_cast<void*>(static_cast<quintptr>(++connectAttempt)), connectListener);
     }
     catch(...) 
     {
-        delete connection;
         return false;
     }
 
-    connected = true;
     return true;
 }
 
+void Client::onConnectCompleted(quint64 attempt, bool success)
+{
+    // Result of attempt that was superseded or cancelled by disconnect
+    if(attempt != connectAttempt || state == ConnectionState::Disconnected || state == ConnectionState::Connected)
+        return;
+
+    if(success)
+    {
+        auto reconnected = state == ConnectionState::Reconnecting;
+        state = ConnectionState::Connected;
+        reconnectDelay = minReconnectDelay;
+
+        // Server does not have to remember our session, so subscribe everything again
+        // This also sends subscriptions requested while the connection was not established yet
+        batchedSubscriptions.clear();
+        sendSubscriptions(subscriptions.values());
+
+        flushPublishQueue();
+        emit connected(reconnected);
+        return;
+    }
+
+    // First connection attempt failed, most likely wrong address
+    if(state == ConnectionState::Connecting)
+    {
+        state = ConnectionState::Disconnected;
+        subscriptions.clear();
+        dropPublishQueue();
+        emit connectionFailed();
+        return;
+    }
+
+    scheduleReconnect();
+}
+
+void Client::scheduleReconnect()
+{
+    state = ConnectionState::Reconnecting;
+    reconnectTimer.start(reconnectDelay);
+    emit reconnecting(reconnectDelay / 1000);
+
+    // Exponential backoff so unavailable server is not flooded with connection attempts
+    reconnectDelay = std::min(reconnectDelay * 2, maxReconnectDelay);
+}
+
+void Client::onReconnectTimeout()
+{
+    if(state != ConnectionState::Reconnecting)
+        return;
+
+    if(!startConnectAttempt())
+        scheduleReconnect();
+}
+
+void Client::onConnectionInterrupted()
+{
+    // Only established connection can be lost, failed attempts are handled by connect listener
+    if(state != ConnectionState::Connected)
+        return;
+
+    // Unanswered packets are sent again with all subscriptions after reconnect
+    pendingSubscribes.clear();
+    scheduleReconnect();
+}
+
 void Client::disconnect()
 {
-    if(!connected)
+    if(state == ConnectionState::Disconnected)
         return;
 
-    if(connection->is_connected())
-        connection->disconnect()->wait();
+    reconnectTimer.stop();
+
+    try
+    {
+        if(connection->is_connected())
+            connection->disconnect()->wait_for(std::chrono::milliseconds(1000));
+    }
+    catch(...) {}
         
-    connected = false;
+    state = ConnectionState::Disconnected;
+    subscriptions.clear();
+    batchedSubscriptions.clear();
+    pendingSubscribes.clear();
+    dropPublishQueue();
+
     delete connection;
+    connection = Q_NULLPTR;
+}
+
+ConnectionState Client::getState()
+{
+    return state;
 }
 
 void Client::subscribe(QString topic)
 {
-    if(!connected || !connection->is_connected())
+    if(state == ConnectionState::Disconnected)
         return;
 
-    connection->subscribe(topic.toStdString(), 1, mqtt::subscribe_options(true));
+    subscriptions.insert(topic);
+
+    // While reconnecting the topic is subscribed after connection is established again
+    if(state != ConnectionState::Connected)
+        return;
+
+    if(batchDepth > 0)
+        batchedSubscriptions.append(topic);
+    else
+        sendSubscriptions(QStringList() << topic);
 }
 
 void Client::unsubscribe(QString topic)
 {
-    if(!connected || !connection->is_connected())
+    if(state == ConnectionState::Disconnected)
         return;
 
-    connection->unsubscribe(topic.toStdString());
+    subscriptions.remove(topic);
+    batchedSubscriptions.removeAll(topic);
+
+    if(state == ConnectionState::Connected)
+        connection->unsubscribe(topic.toStdString());
+}
+
+void Client::beginBatch()
+{
+    batchDepth++;
+}
+
+void Client::endBatch()
+{
+    if(batchDepth == 0 || --batchDepth > 0)
+        return;
+
+    auto topics = batchedSubscriptions;
+    batchedSubscriptions.clear();
+
+    if(state == ConnectionState::Connected)
+        sendSubscriptions(topics);
+}
+
+void Client::sendSubscriptions(QStringList topics)
+{
+    for(auto start = 0; start < topics.count(); start += maxTopicsPerSubscribe)
+    {
+        auto count = std::min(maxTopicsPerSubscribe, topics.count() - start);
+        auto filters = mqtt::string_collection::create();
+
+        for(auto i = start; i < start + count; i++)
+            filters->push_back(topics[i].toStdString());
+
+        auto id = nextSubscribeId++;
+        pendingSubscribes.insert(id, topics.mid(start, count));
+
+        // One packet for many topics, the server answers them with one SUBACK
+        try
+        {
+            connection->subscribe(filters, mqtt::iasync_client::qos_collection(count, 1), 
+                reinterpret_cast<void*>(static_cast<quintptr>(id)), subscribeListener,
+                std::vector<mqtt::subscribe_options>(count, mqtt::subscribe_options(true)));
+        }
+        catch(...)
+        {
+            // Packet could not be sent, the topics stay in subscriptions and are sent again after reconnect
+            pendingSubscribes.remove(id);
+        }
+    }
+}
+
+void Client::onSubscribeCompleted(quint64 id, bool success, QVector<int> codes)
+{
+    // Packet sent before disconnect or connection loss
+    if(!pendingSubscribes.contains(id))
+        return;
+
+    // Failure caused by lost connection is not a rejection, the topics are sent again after reconnect
+    if(!success && (connection == Q_NULLPTR || !connection->is_connected()))
+        return;
+
+    auto topics = pendingSubscribes.take(id);
+    QStringList rejected;
+
+    // Return code 0x80 and above rejects the topic, granted QoS is below it
+    for(auto i = 0; i < topics.count(); i++)
+        if(!success || (i < codes.count() && codes[i] >= 0x80))
+            rejected.append(topics[i]);
+
+    // Rejected topics are not subscribed again after reconnect
+    for(auto &topic : rejected)
+        subscriptions.remove(topic);
+
+    emit subscribeCompleted(topics.count() - rejected.count(), rejected);
 }
 
 void Client::publish(QString topic, QString data)
 {
-    if(!connected || !connection->is_connected())
+    // Messages published while reconnecting stay queued until connection is established
+    if(state == ConnectionState::Disconnected)
         return;
 
-    connection->publish(topic.toStdString(), data.toStdString());
-    emit receivedMessage(topic, data, true);
+    auto payload = data.toUtf8();
+    publishQueue.enqueue(QueuedPublish { topic, payload });
+    flushPublishQueue();
+    emit receivedMessage(topic, payload, false, true);
 }
 
 void Client::publish(QString topic, QByteArray data)
 {
-    if(!connected || !connection->is_connected())
+    publish(topic, data, QMap<QString, QString>());
+}
+
+void Client::publish(QString topic, QByteArray data, QMap<QString, QString> properties)
+{
+    if(state == ConnectionState::Disconnected)
+        return;
+
+    publishQueue.enqueue(QueuedPublish { topic, data, properties });
+    flushPublishQueue();
+    emit receivedMessage(topic, data, decodePayloads && Utils::isImage(data), true);
+}
+
+void Client::setDecodePayloads(bool decode)
+{
+    decodePayloads = decode;
+}
+
+void Client::setInflightWindow(int window)
+{
+    inflightWindow = std::max(window, 1);
+    flushPublishQueue();
+}
+
+void Client::setPublishQos(int qos)
+{
+    publishQos = qos;
+}
+
+PublishStatistics Client::getPublishStatistics()
+{
+    statistics.pending = inflight.count();
+    statistics.queued = publishQueue.count();
+    return statistics;
+}
+
+void Client::flushPublishQueue()
+{
+    if(state != ConnectionState::Connected)
+    {
+        emit publishStatisticsChanged();
         return;
+    }
+
+    while(!publishQueue.isEmpty() && inflight.count() < inflightWindow)
+    {
+        auto message = publishQueue.dequeue();
+        auto id = nextPublishId++;
+
+        InflightPublish entry;
+        entry.topic = message.topic;
+        entry.timer.start();
+        inflight.insert(id, entry);
 
-    connection->publish(topic.toStdString(), data.data(), data.size());
-    emit receivedMessage(topic, convertByteArray(data), true);
+        try
+        {
+            auto payload = mqtt::make_message(message.topic.toStdString(), message.data.constData(), message.data.size(), publishQos, false);
+
+            if(!message.properties.isEmpty())
+            {
+                mqtt::properties properties;
+                for(auto it = message.properties.cbegin(); it != message.properties.cend(); ++it)
+                    properties.add(mqtt::property(mqtt::property::USER_PROPERTY, it.key().toStdString(), it.value().toStdString()));
+
+                payload->set_properties(properties);
+            }
+
+            connection->publish(payload, reinterpret_cast<void*>(static_cast<quintptr>(id)), deliveryListener);
+        }
+        catch(...)
+        {
+            inflight.remove(id);
+            statistics.failed++;
+        }
+    }
+
+    emit publishStatisticsChanged();
+}
+
+void Client::onPublishCompleted(quint64 id, bool success)
+{
+    auto entry = inflight.find(id);
+
+    // Message was already dropped on disconnect
+    if(entry == inflight.end())
+        return;
+
+    if(success)
+    {
+        // Find first bucket whose upper bound is above measured latency
+        auto elapsed = entry->timer.elapsed();
+        auto bucket = 0;
+        while(bucket < PublishStatistics::latencyBuckets - 1 && elapsed >= (1LL << bucket))
+            bucket++;
+
+        statistics.latency[bucket]++;
+        statistics.acked++;
+    }
+    else
+        statistics.failed++;
+
+    inflight.erase(entry);
+    flushPublishQueue();
+}
+
+void Client::dropPublishQueue()
+{
+    statistics.failed += publishQueue.count() + inflight.count();
+    publishQueue.clear();
+    inflight.clear();
+    emit publishStatisticsChanged();
 }
 
 void Client::onDisconnected([[maybe_unused]] mqtt::properties properties, [[maybe_unused]] mqtt::ReasonCode reasonCode)
 {
-    qCritical("Connection unexpectedly terminated by server.");
+    qWarning("Connection unexpectedly terminated by server.");
 
-    // we must exit because of the bug in Paho Eclipse library (most likely) 
-    // we are not able to recover from this situation as the app would freeze forever
-    // exit is absolutely not a good way to handle such situation (especially in multi threaded program)
-    exit(1);
+    // Paho must not be called from its own callback (the app would freeze forever),
+    // so the reconnect is scheduled in the thread of Client
+    QMetaObject::invokeMethod(this, &Client::onConnectionInterrupted, Qt::QueuedConnection);
 }
 
 void Client::onConnectionLost([[maybe_unused]] mqtt::string reason)
 {
-    qCritical("Connection to server was lost.");
+    qWarning("Connection to server was lost.");
 
-    // we must exit because of the bug in Paho Eclipse library (most likely) 
-    // we are not able to recover from this situation as the app would freeze forever
-    // exit is absolutely not a good way to handle such situation (especially in multi threaded program)
-    exit(1);
+    QMetaObject::invokeMethod(this, &Client::onConnectionInterrupted, Qt::QueuedConnection);
 }
 
 void Client::onMessageReceived(mqtt::const_message_ptr message)
 {
-    if(!connected || !connection->is_connected())
+    if(state == ConnectionState::Disconnected)
         return;
 
     auto topic = QString::fromStdString(message->get_topic());
-    auto data = QByteArray::fromRawData(message->get_payload().data(), message->get_payload().size());
 
-    emit receivedMessage(topic, convertByteArray(data), false);
-}
+    // Deep copy, message is destroyed when the callback returns
+    auto data = QByteArray(message->get_payload().data(), message->get_payload().size());
 
-QVariant Client::convertByteArray(QByteArray data)
-{
-    // Only binary type that is supported is image, so try to parse it and it
-    // If it is not image, create string from the data
-    QVariant variant;
-    QPixmap pixmap;
-    if(pixmap.loadFromData(data))
-        return pixmap;
-    
-    return QString(data);
+    // User properties are converted only when the message has any
+    auto &properties = message->get_properties();
+    auto count = properties.count(mqtt::property::USER_PROPERTY);
+    if(count > 0)
+    {
+        QMap<QString, QString> userProperties;
+        for(size_t i = 0; i < count; i++)
+        {
+            auto property = mqtt::get<mqtt::string_pair>(properties, mqtt::property::USER_PROPERTY, i);
+            userProperties.insert(QString::fromStdString(std::get<0>(property)), QString::fromStdString(std::get<1>(property)));
+        }
+
+        emit receivedProperties(topic, userProperties);
+    }
+
+    emit receivedMessage(topic, data, decodePayloads && Utils::isImage(data), false);
 }
 
 Client::~Client()
 {
-    if(connected)
-        delete connection;
+    delete connection;
 }
\ No newline at end of file
@@ -8,13 +8,108 @@
 #ifndef E_CLIENT_H
 #define E_CLIENT_H
 
+#include <array>
+#include <functional>
+
+#include <QMap>
+#include <QSet>
+#include <QHash>
+#include <QQueue>
+#include <QTimer>
 #include <QString>
 #include <QObject>
-#include <QVariant>
+#include <QStringList>
+#include <QVector>
 #include <QByteArray>
+#include <QElapsedTimer>
 
 #include "mqtt/async_client.h"
 
+/*!
+ * @brief Adapter that forwards Paho action callbacks to std::function
+ *
+ * Callbacks are invoked from the Paho thread
+ */
+class ActionListener : public mqtt::iaction_listener
+{
+public:
+    //! Called when the action succeeded
+    std::function<void(const mqtt::token&)> success;
+
+    //! Called when the action failed
+    std::function<void(const mqtt::token&)> failure;
+
+private:
+    void on_success(const mqtt::token& token) override
+    {
+        if(success)
+            success(token);
+    }
+
+    void on_failure(const mqtt::token& token) override
+    {
+        if(failure)
+            failure(token);
+    }
+};
+
+//! State of connection to the server
+enum class ConnectionState
+{
+    Disconnected,   //!< Not connected and not trying to connect
+    Connecting,     //!< First connection attempt is in progress
+    Connected,      //!< Connection is established
+    Reconnecting    //!< Connection was lost, client is trying to establish it again
+};
+
+//! Delivery counters of published messages
+class PublishStatistics
+{
+public:
+    //! Number of buckets in latency histogram, bucket i holds latencies below 2^i ms, the last one everything above
+    static constexpr int latencyBuckets = 12;
+
+    //! Messages acknowledged by the server
+    quint64 acked = 0;
+
+    //! Messages that could not be delivered
+    quint64 failed = 0;
+
+    //! Messages sent to the server that were not acknowledged yet
+    int pending = 0;
+
+    //! Messages waiting for a free slot in the inflight window
+    int queued = 0;
+
+    //! Histogram of acknowledgement latencies
+    std::array<quint64, latencyBuckets> latency {};
+};
+
+//! Message waiting to be published
+class QueuedPublish
+{
+public:
+    //! Topic name
+    QString topic;
+
+    //! Payload
+    QByteArray data;
+
+    //! MQTT v5 user properties
+    QMap<QString, QString> properties;
+};
+
+//! Message that was published and waits for acknowledgement
+class InflightPublish
+{
+public:
+    //! Topic name
+    QString topic;
+
+    //! Measures time since the message was handed to Paho
+    QElapsedTimer timer;
+};
+
 //! Eclipse Paho wrapper
 class Client : public QObject
 {
@@ -31,14 +126,25 @@ public:
     ~Client();
 
     /*! 
-     * @brief Connect to the specified server
+     * @brief Start connecting to the specified server
+     *
+     * Result is reported by connected or connectionFailed signal.
+     * When established connection is lost, client reconnects with exponential backoff
+     * and subscribes all topics again.
+     * 
      * @param address Hostname
-     * @returns true when connected successfuly, false otherwise
+     * @returns true when connection attempt was started, false when client is not disconnected or address is invalid
      */
     bool connect(QString address);
 
-    //! Disconnect from the server
+    //! Disconnect from the server and stop reconnecting
     void disconnect();
+
+    /*!
+     * @brief Get state of connection
+     * @returns connection state
+     */
+    ConnectionState getState();
     
     /*! 
      * @brief Subscibe topic
@@ -52,6 +158,16 @@ public:
      */
     void unsubscribe(QString topic);
 
+    /*!
+     * @brief Start collecting subscriptions instead of sending them one by one
+     *
+     * Batches can be nested, subscriptions are sent when the outermost batch ends.
+     */
+    void beginBatch();
+
+    //! End batch and send collected subscriptions in as few SUBSCRIBE packets as possible
+    void endBatch();
+
     /*!
      * @brief Publish text to topic
      * @param topic Topic name
@@ -66,14 +182,82 @@ public:
      */
     void publish(QString topic, QByteArray data);
 
+    /*!
+     * @brief Publish ByteArray to topic with MQTT v5 user properties
+     * @param topic Topic name
+     * @param data ByteArray
+     * @param properties User properties, the payload is sent unchanged
+     */
+    void publish(QString topic, QByteArray data, QMap<QString, QString> properties);
+
+    /*!
+     * @brief Set maximum number of messages that may wait for acknowledgement at once
+     * @param window Window size (at least 1)
+     */
+    void setInflightWindow(int window);
+
+    /*!
+     * @brief Set QoS of published messages
+     *
+     * QoS 0 messages complete once they are written to the connection, so the window only bounds
+     * the outgoing buffer, with QoS 1 and 2 they wait for acknowledgement by the server.
+     * @param qos QoS (0, 1 or 2)
+     */
+    void setPublishQos(int qos);
+
+    /*!
+     * @brief Get delivery counters of published messages
+     * @returns statistics
+     */
+    PublishStatistics getPublishStatistics();
+
+    /*!
+     * @brief Set whether received and published payloads are classified as image or text
+     * @param decode false when only raw payloads are needed
+     */
+    void setDecodePayloads(bool decode);
+
 signals:
     /*! 
      * @brief Signal that new message was received
      * @param topic Topic name
-     * @param data Image or string
+     * @param payload Raw payload
+     * @param isImage Whether the payload is image, always false when decoding is turned off
      * @param local Whether the message was sent by this client
      */
-    void receivedMessage(QString topic, QVariant data, bool local);
+    void receivedMessage(QString topic, QByteArray payload, bool isImage, bool local);
+
+    /*!
+     * @brief Signal that received message carries MQTT v5 user properties, emitted before receivedMessage
+     * @param topic Topic name
+     * @param properties User properties
+     */
+    void receivedProperties(QString topic, QMap<QString, QString> properties);
+
+    //! Signal that delivery counters of published messages changed
+    void publishStatisticsChanged();
+
+    /*!
+     * @brief Signal that connection to the server was established
+     * @param reconnected Whether the connection was established again after it was lost
+     */
+    void connected(bool reconnected);
+
+    //! Signal that first connection attempt failed
+    void connectionFailed();
+
+    /*!
+     * @brief Signal that server answered SUBSCRIBE packet
+     * @param accepted Number of topics the server accepted
+     * @param rejected Topics the server rejected, they are no longer subscribed
+     */
+    void subscribeCompleted(int accepted, QStringList rejected);
+
+    /*!
+     * @brief Signal that connection is not available and next attempt is scheduled
+     * @param seconds Delay before next connection attempt
+     */
+    void reconnecting(int seconds);
 
 private:
     /*! 
@@ -95,21 +279,126 @@ private:
      */
     void onMessageReceived(mqtt::const_message_ptr message);
 
-    /*! 
-     * @brief Convert ByteArray to image or string
-     * @param data Byte array
-     * @returns image or string
+    /*!
+     * @brief Ask Paho to connect with stored options
+     * @returns false if Paho refused to start the attempt
+     */
+    bool startConnectAttempt();
+
+    /*!
+     * @brief Connection attempt finished, called in the thread of Client
+     * @param attempt Attempt number
+     * @param success Whether the connection was established
+     */
+    void onConnectCompleted(quint64 attempt, bool success);
+
+    //! Established connection was lost, called in the thread of Client
+    void onConnectionInterrupted();
+
+    //! Wait before next connection attempt
+    void scheduleReconnect();
+
+    //! This slot is called when reconnect delay elapses
+    void onReconnectTimeout();
+
+    //! Hand queued messages to Paho while there is free space in the inflight window
+    void flushPublishQueue();
+
+    /*!
+     * @brief Delivery of published message finished, called in the thread of Client
+     * @param id Publish identifier
+     * @param success Whether the message was acknowledged
      */
-    QVariant convertByteArray(QByteArray data);
+    void onPublishCompleted(quint64 id, bool success);
+
+    //! Fail all queued and inflight messages
+    void dropPublishQueue();
+
+    /*!
+     * @brief Send subscriptions, topics are split into packets of at most maxTopicsPerSubscribe
+     * @param topics Topic names
+     */
+    void sendSubscriptions(QStringList topics);
+
+    /*!
+     * @brief SUBSCRIBE packet was answered, called in the thread of Client
+     * @param id Identifier of the packet
+     * @param success Whether the packet was answered successfully
+     * @param codes Return code of every topic of the packet
+     */
+    void onSubscribeCompleted(quint64 id, bool success, QVector<int> codes);
 
     //! MQTT client instance
-    mqtt::async_client *connection;
+    mqtt::async_client *connection = Q_NULLPTR;
 
     //! Options to connect with
     mqtt::connect_options options;
 
-    //! Whether the client is connected
-    bool connected = false;
+    //! State of connection
+    ConnectionState state = ConnectionState::Disconnected;
+
+    //! Number of the last connection attempt
+    quint64 connectAttempt = 0;
+
+    //! Receives connect callbacks from Paho
+    ActionListener connectListener;
+
+    //! Delay before next reconnect attempt
+    QTimer reconnectTimer;
+
+    //! Minimal delay between reconnect attempts (in milliseconds)
+    static constexpr int minReconnectDelay = 1000;
+
+    //! Maximal delay between reconnect attempts (in milliseconds)
+    static constexpr int maxReconnectDelay = 32000;
+
+    //! Current delay between reconnect attempts (in milliseconds)
+    int reconnectDelay = minReconnectDelay;
+
+    //! Topics that are subscribed again after reconnect
+    QSet<QString> subscriptions;
+
+    //! Nesting level of batches, subscriptions are collected while it is positive
+    int batchDepth = 0;
+
+    //! Subscriptions collected during batch
+    QStringList batchedSubscriptions;
+
+    //! Maximum number of topics in one SUBSCRIBE packet
+    static constexpr int maxTopicsPerSubscribe = 256;
+
+    //! Topics of SUBSCRIBE packets waiting for answer by packet identifier
+    QHash<quint64, QStringList> pendingSubscribes;
+
+    //! Identifier of the next SUBSCRIBE packet
+    quint64 nextSubscribeId = 1;
+
+    //! Receives subscribe callbacks from Paho
+    ActionListener subscribeListener;
+
+    //! Whether payloads are classified as image or text
+    bool decodePayloads = true;
+
+    //! QoS of published messages
+    int publishQos = 1;
+
+    //! Maximum number of inflight messages
+    int inflightWindow = 16;
+
+    //! Messages waiting for a free slot in the inflight window
+    QQueue<QueuedPublish> publishQueue;
+
+    //! Published messages waiting for acknowledgement by publish identifier
+    QHash<quint64, InflightPublish> inflight;
+
+    //! Identifier of the next published message
+    quint64 nextPublishId = 1;
+
+    //! Delivery counters
+    PublishStatistics statistics;
+
+    //! Receives delivery callbacks from Paho
+    ActionListener deliveryListener;
 };
 
 
@@ -7,11 +7,14 @@
 
 #include "explorer.h"
 
+#include <limits>
 #include <algorithm>
 
 #include <QDir>
+#include <QSet>
 #include <QFile>
 #include <QWidget>
+#include <QFileInfo>
 #include <QString>
 #include <QPixmap>
 #include <QVariant>
@@ -20,11 +23,20 @@
 #include <QMetaType>
 #include <QByteArray>
 #include <QJsonArray>
+#include <QJsonValue>
 #include <QJsonObject>
 #include <QMainWindow>
 #include <QPushButton>
 #include <QTreeWidget>
 #include <QListWidget>
+#include <QCheckBox>
+#include <QLineEdit>
+#include <QElapsedTimer>
+#include <QScrollBar>
+#include <QToolTip>
+#include <QHelpEvent>
+#include <QAbstractItemView>
+#include <QStyleOptionViewItem>
 #include <QFileDialog>
 #include <QMessageBox>
 #include <QJsonDocument>
@@ -43,29 +55,65 @@
 #include "widgets/light_switch/light_switch.h"
 #include "widgets/security_camera/security_camera.h"
 #include "widgets/thermostat/thermostat.h"
+#include "widgets/chart/chart.h"
 
 #include "ui_preview_image.h"
 #include "ui_preview_string.h"
 
-Explorer::Explorer(int history, QWidget *parent) : QMainWindow(parent)
+/*!
+ * @brief Memory used by message in memory, decoded images are charged separately
+ * @param message Message
+ * @returns number of bytes
+ */
+static qint64 messageCost(const TopicMessage &message)
+{
+    return message.payload.size();
+}
+
+Explorer::Explorer(int history, int memoryHistory, qint64 memoryBudget, int inflight, int qos, QString sequenceField, QWidget *parent) : QMainWindow(parent)
 {
     setupUi(this);
     
     this->history = history;
+    this->memoryHistory = std::min(memoryHistory, history);
+    payloadCache.setBudget(memoryBudget);
+    this->inflight = inflight;
+    publishQos = qos;
+
+    // "$" stands for the whole payload, "$.a.b" or "a.b" for field of JSON payload
+    if(!sequenceField.isEmpty())
+        sequenceTracking = sequencePath.compile(sequenceField);
 
     client = new Client(this);
+    client->setInflightWindow(inflight);
+    client->setPublishQos(qos);
 
     connect(client, &Client::receivedMessage, this, &Explorer::onReceivedMessage);
+    connect(client, &Client::publishStatisticsChanged, this, &Explorer::onPublishStatisticsChanged);
+    connect(client, &Client::connected, this, &Explorer::onClientConnected);
+    connect(client, &Client::connectionFailed, this, &Explorer::onClientConnectionFailed);
+    connect(client, &Client::reconnecting, this, &Explorer::onClientReconnecting);
+    connect(client, &Client::subscribeCompleted, this, &Explorer::onClientSubscribeCompleted);
+
+    labelPublishStatistics = new QLabel(this);
+    statusBar()->addPermanentWidget(labelPublishStatistics);
+
+    labelSequenceStatistics = new QLabel(this);
+    statusBar()->addPermanentWidget(labelSequenceStatistics);
 
     // Setup button click events
     connect(buttonConnect,          &QPushButton::clicked, this, &Explorer::onConnectButtonClicked);
     connect(buttonPublish,          &QPushButton::clicked, this, &Explorer::onPublishButtonClicked);
     connect(buttonSubscribe,        &QPushButton::clicked, this, &Explorer::onSubscribeButtonClicked);
     connect(buttonSaveState,        &QPushButton::clicked, this, &Explorer::onSaveStateButtonClicked);
+    connect(buttonSaveArchive,      &QPushButton::clicked, this, &Explorer::onSaveArchiveButtonClicked);
+    connect(buttonOpenArchive,      &QPushButton::clicked, this, &Explorer::onOpenArchiveButtonClicked);
     connect(buttonDisconnect,       &QPushButton::clicked, this, &Explorer::onDisconnectButtonClicked);
     connect(buttonPublishFile,      &QPushButton::clicked, this, &Explorer::onPublishFileButtonClicked);
     connect(buttonToggleSimulator,  &QPushButton::clicked, this, &Explorer::onToggleSimulatorButtonClicked);
     connect(buttonToggleSubscribe,  &QPushButton::clicked, this, &Explorer::onToggleSubscribeButtonClicked);
+    connect(buttonImportSubscriptions, &QPushButton::clicked, this, &Explorer::onImportSubscriptionsButtonClicked);
+    connect(buttonExportSubscriptions, &QPushButton::clicked, this, &Explorer::onExportSubscriptionsButtonClicked);
 
     connect(buttonAddWidget,        &QPushButton::clicked, this, &Explorer::onAddWidgetButtonClicked);
     connect(buttonLoadDashboard,    &QPushButton::clicked, this, &Explorer::onLoadDashboardButtonClicked);
@@ -74,22 +122,80 @@ Explorer::Explorer(int history, QWidget *parent) : QMainWindow(parent)
     // Setup tree widget selection event
     connect(topicTree, &QTreeWidget::itemSelectionChanged, this, &Explorer::onTopicSelected);
 
+    // Tree items exist only for children of expanded topics
+    connect(topicTree, &QTreeWidget::itemExpanded, this, &Explorer::onTopicExpanded);
+    connect(topicTree, &QTreeWidget::itemCollapsed, this, &Explorer::onTopicCollapsed);
+
+    // Rows of changed topics are repainted at most once per frame, rows that come into view
+    // (scrolling, resized window, filter) are painted from the current state of topics anyway
+    flushTimer.setSingleShot(true);
+    flushTimer.setInterval(16);
+    connect(&flushTimer, &QTimer::timeout, this, &Explorer::flushDirtyTopics);
+
     // Setup message click event in message history
     connect(topicMessageList, &QListWidget::itemDoubleClicked, this, &Explorer::onMessageDoubleClicked);
+    connect(topicMessageList->verticalScrollBar(), &QScrollBar::valueChanged, this, &Explorer::onMessageListScrolled);
 
     // Hide column that stores topic path
     topicTree->hideColumn(2);
 
+    // Image messages are shown as thumbnails decoded in background
+    thumbnailCache = new ThumbnailCache(this);
+    connect(thumbnailCache, &ThumbnailCache::thumbnailReady, this, &Explorer::onThumbnailReady);
+    topicMessageList->setItemDelegate(new ThumbnailDelegate(thumbnailCache, 48, this));
+    topicTree->setItemDelegate(new TopicDelegate(this, thumbnailCache, 20, this));
+    topicTree->setUniformRowHeights(true);
+
+    // Memory columns are hidden by default, totals are refreshed once a second while shown
+    for(auto column = 3; column <= 5; column++)
+        topicTree->hideColumn(column);
+
+    connect(checkboxMemoryColumns, &QCheckBox::toggled, this, &Explorer::onMemoryColumnsToggled);
+    connect(&memoryTimer, &QTimer::timeout, this, &Explorer::onMemoryTimeout);
+    connect(&memoryReportTimer, &QTimer::timeout, this, &Explorer::onMemoryReportTimeout);
+
+    // Rate columns are hidden by default, subtree rates are rolled up once a second while shown
+    for(auto column = 6; column <= 7; column++)
+        topicTree->hideColumn(column);
+
+    rateClock.start();
+    connect(checkboxRateColumns, &QCheckBox::toggled, this, &Explorer::onRateColumnsToggled);
+    connect(&rateTimer, &QTimer::timeout, this, &Explorer::onRateTimeout);
+
+    connect(inputSearch, &QLineEdit::textChanged, this, &Explorer::onSearchTextChanged);
+    connect(inputTopicFilter, &QLineEdit::textChanged, this, &Explorer::onTopicFilterChanged);
+    connect(treeSearchResults, &QTreeWidget::itemDoubleClicked, this, &Explorer::onSearchResultDoubleClicked);
+
     simulator = new Simulator(this);
+    connect(simulator, &Simulator::stopped, this, &Explorer::onSimulatorStopped);
+
+    snapshot = new Snapshot(this);
+    connect(snapshot, &Snapshot::progress, this, &Explorer::onSnapshotProgress);
+    connect(snapshot, &Snapshot::finished, this, &Explorer::onSnapshotFinished);
+
+    // Progress dialog is not modal, the explorer keeps working while snapshot is being saved
+    snapshotProgress = new QProgressDialog("Saving snapshot...", "Cancel", 0, 0, this);
+    snapshotProgress->setWindowModality(Qt::NonModal);
+    snapshotProgress->setAutoClose(false);
+    snapshotProgress->setAutoReset(false);
+    snapshotProgress->reset();
+    snapshotProgress->hide();
+    connect(snapshotProgress, &QProgressDialog::canceled, snapshot, &Snapshot::cancel);
 
     flowLayout = new FlowLayout();
     scrollAreaWidgetContents_2->setLayout(flowLayout);
 
+    // Widgets scrolled out of view are not repainted
+    connect(flowLayout, &FlowLayout::itemsPlaced, this, &Explorer::updateWidgetVisibility);
+    connect(scrollArea->verticalScrollBar(), &QScrollBar::valueChanged, this, &Explorer::updateWidgetVisibility);
+    connect(scrollArea->horizontalScrollBar(), &QScrollBar::valueChanged, this, &Explorer::updateWidgetVisibility);
+
     // Register all supported widgets
     registeredWidgets["LightSwitch"] = new WidgetFactory<WidgetLightSwitch>;
     registeredWidgets["LcdDisplay"] = new WidgetFactory<WidgetLcdDisplay>;
     registeredWidgets["SecurityCamera"] = new WidgetFactory<WidgetSecurityCamera>;
     registeredWidgets["Thermostat"] = new WidgetFactory<WidgetThermostat>;
+    registeredWidgets["Chart"] = new WidgetFactory<WidgetChart>;
 
     // Add all registered widgets to dashboard combobox
     QMapIterator<QString, IWidgetFactory*> i(registeredWidgets);
@@ -107,23 +213,113 @@ void Explorer::setStatus(QString message, int seconds)
 
 void Explorer::onConnectButtonClicked()
 {
-    topicTree->clear();
+    clearTopics();
     clearDashboard();
 
     address = this->inputServerAddress->text();
 
-    setStatus("Connecting to server...", 0);
     if(!client->connect(address))
     {
         setStatus("Could not connect to this server");
         return;
     }
 
+    // Connection is established in background, disconnect button cancels the attempt
     buttonConnect->setEnabled(false);
     buttonDisconnect->setEnabled(true);
+    buttonOpenArchive->setEnabled(false);
     inputServerAddress->setEnabled(false);
+    setStatus("Connecting to server...", 0);
+}
+
+void Explorer::onClientSubscribeCompleted(int accepted, QStringList rejected)
+{
+    // Rejected topics are not subscribed anymore, so they are no longer shown as subscribed
+    for(auto &topic : rejected)
+    {
+        auto topicData = topics.value(topic, Q_NULLPTR);
+        if(topicData == Q_NULLPTR)
+            continue;
+
+        topicData->isSubscribed = false;
+        markTopicDirty(topicData);
+    }
+
+    if(!rejected.isEmpty())
+        setStatus(QString("Server rejected subscription of %1 topics: %2").arg(rejected.count()).arg(rejected.mid(0, 5).join(", ")));
+    else if(accepted > 1)
+        setStatus(QString("Subscribed %1 topics").arg(accepted));
+}
+
+void Explorer::onClientConnected(bool reconnected)
+{
     tabWidget->setEnabled(true);
-    setStatus("Successfuly connected to server");
+
+    if(reconnected)
+        setStatus("Connection to server was restored");
+    else
+        setStatus("Successfuly connected to server");
+}
+
+void Explorer::onClientConnectionFailed()
+{
+    buttonConnect->setEnabled(true);
+    buttonDisconnect->setEnabled(false);
+    buttonOpenArchive->setEnabled(true);
+    inputServerAddress->setEnabled(true);
+    setStatus("Could not connect to this server");
+
+    emit connectionFailed();
+}
+
+void Explorer::onClientReconnecting(int seconds)
+{
+    // Topic tree, history and dashboard stay available while reconnecting
+    setStatus(QString("Connection to server was lost, reconnecting in %1 s...").arg(seconds), 0);
+}
+
+void Explorer::onPublishStatisticsChanged()
+{
+    auto statistics = client->getPublishStatistics();
+
+    // Nothing was published yet
+    if(statistics.acked + statistics.failed + statistics.pending + statistics.queued == 0)
+    {
+        labelPublishStatistics->clear();
+        return;
+    }
+
+    // Median acknowledgement latency from histogram, reported as upper bound of its bucket
+    quint64 total = 0;
+    for(auto count : statistics.latency)
+        total += count;
+
+    auto median = QString("-");
+    quint64 sum = 0;
+    for(auto bucket = 0; bucket < PublishStatistics::latencyBuckets && total > 0; bucket++)
+    {
+        sum += statistics.latency[bucket];
+        if(sum * 2 >= total)
+        {
+            median = bucket == PublishStatistics::latencyBuckets - 1 ? 
+                QString(">%1 ms").arg(1 << (bucket - 1)) : 
+                QString("<%1 ms").arg(1 << bucket);
+            break;
+        }
+    }
+
+    labelPublishStatistics->setText(QString("Published: %1 acked, %2 pending, %3 queued, %4 failed, median ack %5")
+        .arg(statistics.acked).arg(statistics.pending).arg(statistics.queued).arg(statistics.failed).arg(median));
+}
+
+int Explorer::getInflight()
+{
+    return inflight;
+}
+
+int Explorer::getPublishQos()
+{
+    return publishQos;
 }
 
 void Explorer::onDisconnectButtonClicked()
@@ -133,6 +329,7 @@ void Explorer::onDisconnectButtonClicked()
 
     buttonConnect->setEnabled(true);
     buttonDisconnect->setEnabled(false);
+    buttonOpenArchive->setEnabled(true);
     inputServerAddress->setEnabled(true);
     tabWidget->setEnabled(false);
 
@@ -145,43 +342,136 @@ void Explorer::onDisconnectButtonClicked()
     setStatus("Successfuly disconnected from server!");
 }
 
-void Explorer::onReceivedMessage(QString topic, QVariant data, bool local)
+void Explorer::onReceivedMessage(QString topic, QByteArray payload, bool isImage, bool local)
 {
     // Try to find topic in topic tree
-    auto searchResult = topicTree->findItems(topic, Qt::MatchExactly|Qt::MatchCaseSensitive|Qt::MatchRecursive, 2);
+    auto topicData = topics.value(topic, Q_NULLPTR);
     
-    if(searchResult.count() == 0)
+    if(topicData == Q_NULLPTR)
         return;
 
-    auto treeTopicItem = searchResult[0];
+    // Subtree rates are rolled up later, topics with new messages are remembered once
+    if(topicData->rate.record(payload.size(), rateClock.elapsed()))
+        pendingRates.append(topicData);
 
-    auto topicData = getTopicData(treeTopicItem);
-
-    // Only string and image type is supported
-    if(data.userType() == QMetaType::QString)
-        treeTopicItem->setText(1, qvariant_cast<QString>(data).simplified());
-    else if(data.userType() == QMetaType::QPixmap)
-        treeTopicItem->setText(1, "(Image)");
-    else 
-        return;
-
-    // Set color based on the sender of message (1) us (2) anyone else
-    auto color = local ? QColor(255, 255, 0, 127) : QColor(0, 0, 0, 0);
-    treeTopicItem->setBackgroundColor(1, color);
+    // Remember when the content changed, so snapshots can skip unchanged topics,
+    // checked before the history is trimmed, otherwise history of 1 would always look changed
+    auto hash = Utils::hashPayload(payload);
+    if(topicData->messages.isEmpty() || hash != topicData->hash)
+    {
+        topicData->hash = hash;
+        topicData->changed = ++generation;
+    }
 
     // If we reached message history limit, remove the oldest message
-    if(topicData.messages.length() >= history)
-        topicData.messages.pop_back();
+    if(topicData->messages.length() + topicData->spilled.length() >= history)
+    {
+        if(topicData->spilled.isEmpty())
+        {
+            auto oldest = topicData->messages.takeLast();
+            releaseMessage(topicData, oldest);
+            unindexMessage(topicData, oldest.id);
+        }
+        else
+        {
+            auto oldest = topicData->spilled.takeLast();
+            historyStore.release(oldest);
+            unindexMessage(topicData, oldest.id);
+            topicData->memory.count(0, -1);
+        }
+    }
+
+    // Only the newest messages stay in memory, older ones are moved to disk
+    if(topicData->messages.length() >= memoryHistory)
+        spillMessage(topicData, topicData->messages.takeLast());
+
+    // Previous newest message can now leave memory when the budget is exceeded
+    if(!topicData->messages.isEmpty())
+        spillable.insert(topicData->messages.first().id, topicData);
+
+    TopicMessage message;
+    message.id = ++lastMessageId;
+    message.payload = payload;
+    message.isImage = isImage;
+    message.local = local;
+    message.time = QDateTime::currentDateTime();
+    topicData->messages.prepend(message);
+    topicData->memory.count(1, 0);
+
+    // Text stays searchable for as long as it is in the history, also after it is spilled to disk,
+    // only the indexed prefix is decoded, UTF-8 character takes at most 4 bytes
+    if(!message.isImage)
+        indexMessage(topicData, message.id, topic, QString::fromUtf8(payload.left(SearchIndex::maxTextLength * 4)), message.time.toMSecsSinceEpoch());
+
+    // Tree item is updated with the next frame if it is visible
+    markTopicDirty(topicData);
+
+    // Images are decoded only when opened, decoded image is then kept while the budget allows
+    payloadCache.addRaw(&topicData->memory, messageCost(message));
+
+    // Raw payloads alone exceed the budget, the oldest messages of all topics leave memory,
+    // the oldest spillable message is always the last one in memory of its topic
+    while(payloadCache.isOverBudget() && !spillable.isEmpty())
+    {
+        auto owner = spillable.first();
+        spillMessage(owner, owner->messages.takeLast());
+        markTopicDirty(owner);
+    }
 
-    topicData.messages.prepend(std::make_tuple(data, local, QDateTime::currentDateTime()));
-    setTopicData(treeTopicItem, topicData);
+    // Messages published by us do not belong to the sequence of the device
+    if(!local && sequenceTracking)
+        trackSequence(topicData, payload);
 
-    emit messageReceived(topic, data, local);
+    emit messageReceived(topic, payload, isImage, local);
 
-    // Reload message list if this topic is currently selected
+    // Update message list if this topic is currently selected, rows of the history did not change,
+    // so only the new message is inserted and the dropped one removed
     auto selected = getSelectedTopic();
-    if(selected != Q_NULLPTR && selected == treeTopicItem)
-        reloadMessageList();
+    if(selected != Q_NULLPTR && selected == topicData->widgetItem)
+    {
+        addMessageItem(message, 0);
+
+        while(topicMessageList->count() > topicData->messages.length() + topicData->spilled.length())
+            delete topicMessageList->takeItem(topicMessageList->count() - 1);
+    }
+}
+
+void Explorer::spillMessage(TopicData *topicData, const TopicMessage &message)
+{
+    releaseMessage(topicData, message);
+
+    HistoryRef ref;
+    ref.id = message.id;
+    ref.time = message.time.toMSecsSinceEpoch();
+    ref.local = message.local;
+    ref.isImage = message.isImage;
+
+    if(historyStore.append(message.payload, ref))
+    {
+        topicData->spilled.prepend(ref);
+        topicData->memory.count(0, 1);
+    }
+    else
+        unindexMessage(topicData, message.id);
+}
+
+void Explorer::indexMessage(TopicData *topicData, quint64 id, QString topic, QString text, qint64 time)
+{
+    // Index stays in memory also for messages spilled to disk, so it is charged to the topic
+    payloadCache.addRaw(&topicData->memory, searchIndex.add(id, topic, text, time));
+}
+
+void Explorer::unindexMessage(TopicData *topicData, quint64 id)
+{
+    payloadCache.removeRaw(&topicData->memory, searchIndex.remove(id));
+}
+
+void Explorer::releaseMessage(TopicData *topicData, const TopicMessage &message)
+{
+    spillable.remove(message.id);
+    payloadCache.remove(message.id);
+    payloadCache.removeRaw(&topicData->memory, messageCost(message));
+    topicData->memory.count(-1, 0);
 }
 
 void Explorer::onSubscribeButtonClicked()
@@ -221,89 +511,753 @@ void Explorer::onSubscribeButtonClicked()
         inputSubscribeTopic->setText("");
 }
 
+void Explorer::onImportSubscriptionsButtonClicked()
+{
+    auto data = Utils::loadFile(this, "Select subscription list", "Text files (*.txt);;All files (*)");
+
+    if(data.isEmpty())
+        return;
+
+    importSubscriptions(data);
+}
+
+void Explorer::onExportSubscriptionsButtonClicked()
+{
+    if(!Utils::saveFile(this, exportSubscriptions(), "Save subscription list", "Text files (*.txt);;All files (*)"))
+        setStatus("Failed to save subscription list");
+}
+
+int Explorer::importSubscriptions(QByteArray data)
+{
+    auto imported = 0;
+    auto skipped = 0;
+
+    // Tree is laid out and painted once and topics are sent in few SUBSCRIBE packets
+    topicTree->setUpdatesEnabled(false);
+    client->beginBatch();
+
+    for(auto line : data.split('\n'))
+    {
+        auto topic = QString::fromUtf8(line).trimmed();
+
+        if(topic.isEmpty())
+            continue;
+
+        if(subscribeTopic(topic) == 0)
+            imported++;
+        else
+            skipped++;
+    }
+
+    client->endBatch();
+    topicTree->setUpdatesEnabled(true);
+
+    setStatus(QString("Imported %1 subscriptions, %2 skipped").arg(imported).arg(skipped));
+    return imported;
+}
+
+QByteArray Explorer::exportSubscriptions()
+{
+    QStringList paths;
+
+    for(auto topicData : topics)
+        if(topicData->isSubscribed)
+            paths.append(topicData->path);
+
+    paths.sort();
+    return paths.join("\n").toUtf8() + "\n";
+}
+
 int Explorer::subscribeTopic(QString topic, QTreeWidgetItem *root)
 {
     // Wildcards are not supported
     if(topic.contains("#"))
         return 1;
 
+    auto topicData = createTopic(topic, root);
+
+    if(topicData == Q_NULLPTR) 
+        return 2;
+
+    if(topicData->isSubscribed)
+        return 3;
+
+    topicData->isSubscribed = true;
+
+    client->subscribe(topicData->path);
+
+    // Make topic name blue so we can easily see which topics are subscribed
+    markTopicDirty(topicData);
+    return 0;
+}
+
+void Explorer::publishData(QString topic, QString data)
+{
+    client->publish(topic, data);
+}
+
+void Explorer::publishData(QString topic, QByteArray data)
+{
+    client->publish(topic, data);
+}
+
+TopicData* Explorer::createTopic(QString topic, QTreeWidgetItem *root)
+{
     // Split specified topic by subtopics, so we can build tree structure
     auto path = topic.split("/", QString::SkipEmptyParts);
 
-    if(path.count() == 0) 
-        return 2;
+    if(path.count() == 0) 
+        return Q_NULLPTR;
+
+    auto current = root == Q_NULLPTR ? Q_NULLPTR : getTopicData(root);
+
+    for(auto path_i = 0; path_i < path.count(); path_i++) 
+    {
+        auto parent = current;
+        auto targetPath = parent == Q_NULLPTR ? path[path_i] : parent->path + "/" + path[path_i];
+
+        // We found existing partial path, we do not have to create this element again
+        current = topics.value(targetPath, Q_NULLPTR);
+        if(current != Q_NULLPTR)
+            continue;
+
+        current = new TopicData();
+        current->name = path[path_i];
+        current->path = targetPath;
+        current->parent = parent;
+        current->memory.parent = parent == Q_NULLPTR ? Q_NULLPTR : &parent->memory;
+        current->rate.parent = parent == Q_NULLPTR ? Q_NULLPTR : &parent->rate;
+        current->changed = ++generation;
+        current->depth = parent == Q_NULLPTR ? 0 : parent->depth + 1;
+        topics.insert(targetPath, current);
+        topicsByName[current->name.toLower()].append(current);
+
+        // Dashboard widgets may still hold memory of the topic from before reconnect
+        if(widgetMemory.contains(targetPath))
+            payloadCache.addRaw(&current->memory, widgetMemory.value(targetPath));
+
+        if(parent == Q_NULLPTR)
+            rootTopics.append(current);
+        else
+            parent->children.append(current);
+
+        for(auto ancestor = parent; ancestor != Q_NULLPTR; ancestor = ancestor->parent)
+            ancestor->descendants++;
+
+        // New topic is checked against active filter alone, the rest of the tree is not evaluated again
+        if(!topicFilter.isEmpty() && matchesTopicFilter(current))
+            addFilterMatch(current);
+
+        if(parent == Q_NULLPTR)
+        {
+            topicTree->addTopLevelItem(materializeTopic(current));
+            current->widgetItem->setHidden(!isTopicVisible(current));
+            continue;
+        }
+
+        // Collapsed topics only count their children, tree items are created when expanded
+        auto parentItem = parent->widgetItem;
+        if(parentItem != Q_NULLPTR && parent->children.count() == 1)
+            parentItem->setChildIndicatorPolicy(QTreeWidgetItem::ShowIndicator);
+
+        if(parentItem == Q_NULLPTR || !isTopicVisible(current))
+            continue;
+
+        if(parentItem->isExpanded())
+        {
+            // Topic expanded automatically is collapsed once it gets too many children
+            if(parent->autoExpanded && parent->children.count() > autoExpandChildren)
+            {
+                parent->autoExpanded = false;
+                autoCollapsing = true;
+                parentItem->setExpanded(false);
+                autoCollapsing = false;
+            }
+            // Matching topic may already have got its item while its ancestors were revealed
+            else if(current->widgetItem == Q_NULLPTR)
+                parentItem->addChild(materializeTopic(current));
+        }
+        else if(parent->depth < autoExpandDepth && parent->children.count() <= autoExpandChildren && !parent->userCollapsed)
+        {
+            parent->autoExpanded = true;
+            parentItem->setExpanded(true);
+            materializeChildren(parent);
+        }
+
+        markTopicDirty(parent);
+    }
+
+    return current;
+}
+
+QTreeWidgetItem* Explorer::materializeTopic(TopicData *topicData)
+{
+    auto item = new QTreeWidgetItem();
+    item->setText(0, topicData->name.simplified());
+    item->setText(2, topicData->path);
+    item->setData(0, TopicDelegate::topicRole, QVariant::fromValue((void*) topicData));
+
+    // Collapsed topic shows that it has children even without their items
+    item->setChildIndicatorPolicy(topicData->children.isEmpty() ? 
+        QTreeWidgetItem::DontShowIndicatorWhenChildless : QTreeWidgetItem::ShowIndicator);
+
+    topicData->widgetItem = item;
+    return item;
+}
+
+void Explorer::materializeChildren(TopicData *topicData)
+{
+    QList<QTreeWidgetItem*> items;
+
+    // Children filtered out do not get tree items at all
+    for(auto child : topicData->children)
+        if(child->widgetItem == Q_NULLPTR && isTopicVisible(child))
+            items.append(materializeTopic(child));
+
+    // Items are added at once, so the view lays them out once
+    topicData->widgetItem->addChildren(items);
+}
+
+void Explorer::dematerializeChildren(TopicData *topicData)
+{
+    for(auto child : topicData->children)
+    {
+        if(child->widgetItem == Q_NULLPTR)
+            continue;
+
+        dematerializeChildren(child);
+        dirtyTopics.remove(child);
+        child->widgetItem = Q_NULLPTR;
+        child->autoExpanded = false;
+    }
+}
+
+void Explorer::revealTopic(TopicData *topicData)
+{
+    QList<TopicData*> ancestors;
+    for(auto ancestor = topicData->parent; ancestor != Q_NULLPTR; ancestor = ancestor->parent)
+        ancestors.prepend(ancestor);
+
+    // Top level topics always have tree item, every expanded ancestor creates items of its children
+    for(auto ancestor : ancestors)
+    {
+        ancestor->widgetItem->setExpanded(true);
+        materializeChildren(ancestor);
+    }
+}
+
+void Explorer::onTopicExpanded(QTreeWidgetItem *item)
+{
+    auto topicData = getTopicData(item);
+
+    if(topicData == Q_NULLPTR)
+        return;
+
+    topicData->userCollapsed = false;
+    materializeChildren(topicData);
+}
+
+void Explorer::onTopicCollapsed(QTreeWidgetItem *item)
+{
+    auto topicData = getTopicData(item);
+
+    if(topicData == Q_NULLPTR)
+        return;
+
+    // Topic collapsed by the user stays collapsed when new children arrive
+    if(!autoCollapsing)
+        topicData->userCollapsed = true;
+
+    // Collapsed subtree keeps only topic data
+    topicData->autoExpanded = false;
+    dematerializeChildren(topicData);
+    qDeleteAll(item->takeChildren());
+}
+
+void Explorer::onTopicFilterChanged(QString filter)
+{
+    if(filter.trimmed() == topicFilter)
+        return;
+
+    // Visibility under previous filter is kept, so only items that change are shown or hidden
+    auto wasFiltered = !topicFilter.isEmpty();
+    QSet<TopicData*> previous;
+    previous.swap(filterVisible);
+
+    topicFilter = filter.trimmed();
+    topicFilterPattern.clear();
+
+    // Text with topic separator or wildcard is MQTT pattern, anything else is substring of topic name
+    if(topicFilter.contains("/") || topicFilter == "+" || topicFilter == "#")
+        topicFilterPattern = topicFilter.split("/");
+
+    QList<TopicData*> matches;
+
+    if(topicFilterPattern.isEmpty() && !topicFilter.isEmpty())
+    {
+        // Distinct names are far fewer than topics, each of them is checked once
+        for(auto it = topicsByName.constBegin(); it != topicsByName.constEnd(); ++it)
+            if(it.key().contains(topicFilter, Qt::CaseInsensitive))
+                matches.append(it.value());
+    }
+    else if(!topicFilterPattern.isEmpty())
+        findPatternMatches(Q_NULLPTR, 0, matches);
+
+    topicTree->setUpdatesEnabled(false);
+
+    // Matches hidden by previous filter are shown by addFilterMatch
+    for(auto match : matches)
+        addFilterMatch(match);
+
+    // Only existing tree items are shown or hidden, collapsed subtrees are filtered when expanded
+    auto isFiltered = !topicFilter.isEmpty();
+    if(wasFiltered && isFiltered)
+    {
+        // Both filters keep few topics visible, topics left out by the new one are hidden
+        for(auto topicData : previous)
+            if(topicData->widgetItem != Q_NULLPTR && !filterVisible.contains(topicData))
+                topicData->widgetItem->setHidden(true);
+    }
+    else if(isFiltered)
+    {
+        // Whole tree was visible, every existing item outside of matches is hidden
+        for(QTreeWidgetItemIterator it(topicTree); *it; ++it)
+        {
+            auto topicData = getTopicData(*it);
+            if(topicData != Q_NULLPTR && !filterVisible.contains(topicData))
+                (*it)->setHidden(true);
+        }
+    }
+    else if(wasFiltered)
+    {
+        // Filter was cleared, items hidden by it are shown again
+        QList<TopicData*> expanded;
+        for(QTreeWidgetItemIterator it(topicTree); *it; ++it)
+        {
+            auto topicData = getTopicData(*it);
+            if(topicData == Q_NULLPTR)
+                continue;
+
+            if(!previous.contains(topicData))
+                (*it)->setHidden(false);
+
+            if((*it)->isExpanded())
+                expanded.append(topicData);
+        }
+
+        // Expanded topics get items of children that were filtered out before
+        for(auto topicData : expanded)
+            materializeChildren(topicData);
+    }
+
+    // Show the first matches, revealing all of them could create too many items
+    for(auto i = 0; i < matches.count() && i < maxRevealedMatches; i++)
+        revealTopic(matches[i]);
+
+    topicTree->setUpdatesEnabled(true);
+
+    if(!topicFilter.isEmpty())
+        setStatus(QString("Filter matches %1 topics").arg(matches.count()));
+}
+
+void Explorer::findPatternMatches(TopicData *parent, int level, QList<TopicData*> &matches)
+{
+    auto &children = parent == Q_NULLPTR ? rootTopics : parent->children;
+    auto segment = topicFilterPattern[level];
+    auto last = level == topicFilterPattern.count() - 1;
+
+    // Multi-level wildcard matches the parent and its whole subtree
+    if(segment == "#")
+    {
+        if(parent != Q_NULLPTR)
+            matches.append(parent);
+
+        QList<TopicData*> stack = children;
+        while(!stack.isEmpty())
+        {
+            auto topicData = stack.takeLast();
+            matches.append(topicData);
+            stack.append(topicData->children);
+        }
+
+        return;
+    }
+
+    // Single-level wildcard tries every child
+    if(segment == "+")
+    {
+        for(auto child : children)
+        {
+            if(last)
+                matches.append(child);
+            else
+                findPatternMatches(child, level + 1, matches);
+        }
+
+        return;
+    }
+
+    // Literal segment is looked up directly and must match the whole name, as in MQTT subscriptions
+    auto child = topics.value(parent == Q_NULLPTR ? segment : parent->path + "/" + segment, Q_NULLPTR);
+    if(child == Q_NULLPTR)
+        return;
+
+    if(last)
+        matches.append(child);
+    else
+        findPatternMatches(child, level + 1, matches);
+}
+
+bool Explorer::matchesTopicFilter(TopicData *topicData)
+{
+    if(topicFilterPattern.isEmpty())
+        return topicData->name.contains(topicFilter, Qt::CaseInsensitive);
+
+    // Same rules as findPatternMatches, applied to single topic
+    auto path = topicData->path.split("/", QString::SkipEmptyParts);
+    for(auto i = 0; i < topicFilterPattern.count(); i++)
+    {
+        auto &segment = topicFilterPattern[i];
+
+        if(segment == "#")
+            return i == 0 || path.count() >= i;
+
+        if(i >= path.count())
+            return false;
+
+        if(segment != "+" && path[i] != segment)
+            return false;
+    }
+
+    return path.count() == topicFilterPattern.count();
+}
+
+void Explorer::addFilterMatch(TopicData *topicData)
+{
+    // Ancestors of match stay visible, so the match can be reached
+    QList<TopicData*> revealed;
+    for(auto topic = topicData; topic != Q_NULLPTR && !filterVisible.contains(topic); topic = topic->parent)
+    {
+        filterVisible.insert(topic);
+        revealed.prepend(topic);
+
+        if(topic->widgetItem != Q_NULLPTR && topic->widgetItem->isHidden())
+            topic->widgetItem->setHidden(false);
+    }
+
+    // Topics filtered out before have no tree item, expanded parents get it from the top down
+    for(auto topic : revealed)
+    {
+        auto parent = topic->parent;
+        if(topic->widgetItem != Q_NULLPTR || parent == Q_NULLPTR || parent->widgetItem == Q_NULLPTR || !parent->widgetItem->isExpanded())
+            continue;
+
+        parent->widgetItem->addChild(materializeTopic(topic));
+    }
+}
+
+bool Explorer::isTopicVisible(TopicData *topicData)
+{
+    return topicFilter.isEmpty() || filterVisible.contains(topicData);
+}
+
+void Explorer::markTopicDirty(TopicData *topicData)
+{
+    // Topic inside collapsed subtree has no tree item, its row is painted from current state once materialized
+    if(topicData->widgetItem == Q_NULLPTR)
+        return;
+
+    dirtyTopics.insert(topicData);
+    if(!flushTimer.isActive())
+        flushTimer.start();
+}
+
+void Explorer::flushDirtyTopics()
+{
+    if(dirtyTopics.isEmpty())
+        return;
+
+    // Rows are painted from topic data, so the model is not touched and only dirty rows inside viewport are repainted,
+    // rows outside of it show the current state once they are scrolled to
+    auto viewport = topicTree->viewport();
+    for(auto index = topicTree->indexAt(QPoint(0, 0)); index.isValid(); index = topicTree->indexBelow(index))
+    {
+        auto rect = topicTree->visualRect(index);
+        if(rect.top() >= viewport->height())
+            break;
+
+        if(dirtyTopics.contains(getTopicData(index)))
+            viewport->update(0, rect.top(), viewport->width(), rect.height());
+    }
+
+    dirtyTopics.clear();
+}
+
+TopicDelegate::TopicDelegate(Explorer *explorer, ThumbnailCache *cache, int height, QObject *parent) : 
+    ThumbnailDelegate(cache, height, parent), explorer(explorer), height(height) {}
+
+QSize TopicDelegate::sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    auto size = ThumbnailDelegate::sizeHint(option, index);
+    size.setHeight(qMax(size.height(), height));
+
+    return size;
+}
+
+bool TopicDelegate::helpEvent(QHelpEvent *event, QAbstractItemView *view, const QStyleOptionViewItem &option, const QModelIndex &index)
+{
+    auto topicData = explorer->getTopicData(index);
+    if(event->type() != QEvent::ToolTip || topicData == Q_NULLPTR)
+        return ThumbnailDelegate::helpEvent(event, view, option, index);
+
+    auto tooltip = explorer->getTopicToolTip(topicData, index.column());
+    if(tooltip.isEmpty())
+        QToolTip::hideText();
+    else
+        QToolTip::showText(event->globalPos(), tooltip, view);
+
+    return true;
+}
+
+void TopicDelegate::initStyleOption(QStyleOptionViewItem *option, const QModelIndex &index) const
+{
+    ThumbnailDelegate::initStyleOption(option, index);
+
+    auto topicData = explorer->getTopicData(index);
+    if(topicData != Q_NULLPTR)
+        explorer->initTopicOption(option, topicData, index.column());
+}
+
+QVariant TopicDelegate::itemData(const QModelIndex &index, int role) const
+{
+    auto topicData = explorer->getTopicData(index);
+    if(index.column() != 1 || topicData == Q_NULLPTR || topicData->messages.isEmpty())
+        return QVariant();
+
+    auto &message = topicData->messages.first();
+    switch(role)
+    {
+        case payloadRole: return message.payload;
+        case imageRole: return message.isImage;
+        case thumbnailRole: return topicData->hash;
+        default: return QVariant();
+    }
+}
+
+TopicData* Explorer::getTopicData(const QModelIndex &index)
+{
+    return (TopicData*) index.sibling(index.row(), 0).data(TopicDelegate::topicRole).value<void*>();
+}
+
+void Explorer::initTopicOption(QStyleOptionViewItem *option, TopicData *topicData, int column)
+{
+    if(column == 0)
+    {
+        // Make topic name blue so we can easily see which topics are subscribed
+        option->palette.setColor(QPalette::Text, topicData->isSubscribed ? Qt::blue : Qt::black);
+
+        // Mark topic with broken sequence in topic tree
+        auto &sequence = topicData->sequence;
+        if(sequence.missing > 0 || sequence.duplicates > 0 || sequence.reordered > 0 || sequence.restarts > 0)
+            option->backgroundBrush = QColor(255, 0, 0, 60);
+    }
+    else if(column == 1 && !topicData->messages.isEmpty())
+    {
+        auto &message = topicData->messages.first();
+
+        // Text messages already have preview of payload appended by delegate
+        if(message.isImage)
+            option->text = "(Image)";
+
+        // Set color based on the sender of message (1) us (2) anyone else
+        if(message.local)
+            option->backgroundBrush = QColor(255, 255, 0, 127);
+    }
+    else if(column >= 3 && column <= 5)
+    {
+        auto &memory = topicData->memory;
+        if(column == 3)
+            option->text = Utils::formatBytes(memory.subtreeRaw);
+        else if(column == 4)
+            option->text = Utils::formatBytes(memory.subtreeDecoded);
+        else
+            option->text = QString("%1 + %2 on disk").arg(memory.subtreeMessages).arg(memory.subtreeSpilled);
+    }
+    else if(column == 6)
+        option->text = QString::number(topicData->rate.subtreeMessages.rate(rateClock.elapsed()), 'f', 1);
+    else if(column == 7)
+        option->text = Utils::formatBytes((qint64) topicData->rate.subtreeBytes.rate(rateClock.elapsed())) + "/s";
+
+    if(!option->text.isEmpty())
+        option->features |= QStyleOptionViewItem::HasDisplay;
+}
+
+QString Explorer::getTopicToolTip(TopicData *topicData, int column)
+{
+    auto &memory = topicData->memory;
+    auto &rate = topicData->rate;
+
+    switch(column)
+    {
+        case 0:
+        {
+            QStringList tooltip;
+            if(topicData->descendants > 0)
+                tooltip << QString("%1 topics in subtree").arg(topicData->descendants);
+
+            auto &sequence = topicData->sequence;
+            if(sequence.missing > 0 || sequence.duplicates > 0 || sequence.reordered > 0 || sequence.restarts > 0)
+                tooltip << QString("Sequence: %1 missing, %2 duplicates, %3 reordered, %4 restarts")
+                    .arg(sequence.missing).arg(sequence.duplicates).arg(sequence.reordered).arg(sequence.restarts);
+
+            return tooltip.join("\n");
+        }
+        case 3: return "Topic alone: " + Utils::formatBytes(memory.raw);
+        case 4: return "Topic alone: " + Utils::formatBytes(memory.decoded);
+        case 5: return QString("Topic alone: %1 + %2 on disk").arg(memory.messages).arg(memory.spilled);
+        case 6: return "Topic alone: " + QString::number(rate.messages.rate(rateClock.elapsed()), 'f', 1);
+        case 7: return "Topic alone: " + Utils::formatBytes((qint64) rate.bytes.rate(rateClock.elapsed())) + "/s";
+        default: return QString();
+    }
+}
+
+TopicData* Explorer::getTopicData(QTreeWidgetItem* item)
+{
+    return topics.value(item->text(2), Q_NULLPTR);
+}
+
+void Explorer::clearTopics()
+{
+    topicTree->clear();
+    dirtyTopics.clear();
+    pendingRates.clear();
+    filterVisible.clear();
+    rootTopics.clear();
+    topicsByName.clear();
+
+    // Cache does not touch accounts of released topics
+    payloadCache.clear();
+    spillable.clear();
+    qDeleteAll(topics);
+    topics.clear();
+    historyStore.clear();
+    searchIndex.clear();
+
+    sequenceTotals = SequenceState();
+    reloadSequenceStatistics();
+}
+
+/*!
+ * @brief Add counters without wrapping around
+ * @param a first counter
+ * @param b second counter
+ * @returns sum, or maximum value when it does not fit
+ */
+static quint64 saturatedAdd(quint64 a, quint64 b)
+{
+    return b > std::numeric_limits<quint64>::max() - a ? std::numeric_limits<quint64>::max() : a + b;
+}
+
+void Explorer::trackSequence(TopicData *topicData, QByteArray payload)
+{
+    QByteArray value;
+    if(!sequencePath.find(payload, value))
+        return;
+
+    // JSON numbers may be written as doubles, sequence may also be sent as string
+    bool isNumber;
+    value = value.trimmed();
+    qint64 number = value.toLongLong(&isNumber);
+
+    if(!isNumber)
+    {
+        // Converting double outside of qint64 range is undefined, NaN fails the check too
+        auto real = value.toDouble(&isNumber);
+        if(!isNumber || !(real >= -9223372036854775808.0 && real < 9223372036854775808.0))
+            return;
+
+        number = (qint64) real;
+    }
 
-    auto current = root == Q_NULLPTR ? topicTree->invisibleRootItem() : root;
+    // Only the highest received number is stored, so the state has constant size
+    auto &sequence = topicData->sequence;
+    auto previous = sequence;
 
-    for(auto path_i = 0; path_i < path.count(); path_i++) 
+    // Distances are computed unsigned, they fit even when the numbers lie far apart
+    auto distance = (quint64) sequence.last - (quint64) number;
+
+    if(!sequence.valid)
+    {
+        sequence.valid = true;
+        sequence.last = number;
+    }
+    else if(number == sequence.last)
+        sequence.duplicates++;
+    else if(number < sequence.last)
     {
-        auto found = false;
-        // If partial path exists, iterate existing children
-        for(auto child_i = 0; child_i < current->childCount(); child_i++)
+        // Run of increasing numbers below the highest one is either a restarted counter or a burst of late messages
+        if(sequence.lowerRun > 0 && number > sequence.runLast)
+            sequence.lowerRun++;
+        else
         {
-            auto child = current->child(child_i);
-            if(child->text(0) == path[path_i])
-            {
-                current = child;
-                found = true;
-                break;
-            }
+            sequence.lowerRun = 1;
+            sequence.runFilled = 0;
         }
-        
-        // We found existing partial path, we do not have to create this element again
-        if(found)
-            continue;
-
-        auto targetPath = root == Q_NULLPTR ? 
-            path.mid(0, path_i + 1).join("/") : 
-            root->text(2) + "/" + path.mid(0, path_i + 1).join("/");
 
-        TopicData topicData;
-        topicData.widgetItem = new QTreeWidgetItem();
-        topicData.widgetItem->setText(0, path[path_i].simplified());
-        topicData.widgetItem->setText(2, targetPath);
-        setTopicData(topicData.widgetItem, topicData);
+        sequence.runLast = number;
 
-        // Add new element to tree, expand it and continue path construction from this element
-        current->addChild(topicData.widgetItem);
-        current->setExpanded(true);
-        current = topicData.widgetItem;
+        if(distance > sequenceRestartGap || sequence.lowerRun >= sequenceRestartRun)
+        {
+            // Earlier messages of the run were new numbers, not late ones
+            sequence.reordered -= sequence.lowerRun - 1;
+            sequence.missing = saturatedAdd(sequence.missing, sequence.runFilled);
+            sequence.restarts++;
+            sequence.last = number;
+            sequence.lowerRun = 0;
+            sequence.runFilled = 0;
+        }
+        else
+        {
+            // Late message fills a gap that was counted as missing, without the set of received numbers
+            // an old duplicate can not be told apart from it and is counted as reordered too
+            sequence.reordered++;
+            if(sequence.missing > 0)
+            {
+                sequence.missing--;
+                sequence.runFilled++;
+            }
+        }
+    }
+    else
+    {
+        sequence.missing = saturatedAdd(sequence.missing, (quint64) number - (quint64) sequence.last - 1);
+        sequence.last = number;
+        sequence.lowerRun = 0;
+        sequence.runFilled = 0;
     }
 
-    // Target topic item is now stored in current
-    auto topicData = getTopicData(current);
-
-    if(topicData.isSubscribed)
-        return 3;
-
-    topicData.isSubscribed = true;
-    setTopicData(current, topicData);
-
-    client->subscribe(current->text(2));
-
-    // Make topic name blue so we can easily see which topics are subscribed
-    current->setForeground(0, QBrush(Qt::blue));
-    return 0;
-}
+    // Nothing unusual happened
+    if(sequence.missing == previous.missing && sequence.duplicates == previous.duplicates &&
+        sequence.reordered == previous.reordered && sequence.restarts == previous.restarts)
+        return;
 
-void Explorer::publishData(QString topic, QString data)
-{
-    client->publish(topic, data);
-}
+    sequenceTotals.missing = saturatedAdd(sequenceTotals.missing - std::min(sequenceTotals.missing, previous.missing), sequence.missing);
+    sequenceTotals.duplicates += sequence.duplicates - previous.duplicates;
+    sequenceTotals.reordered = sequenceTotals.reordered - previous.reordered + sequence.reordered;
+    sequenceTotals.restarts += sequence.restarts - previous.restarts;
 
-void Explorer::publishData(QString topic, QByteArray data)
-{
-    client->publish(topic, data);
+    // Mark topic with broken sequence in topic tree
+    markTopicDirty(topicData);
+    reloadSequenceStatistics();
 }
 
-void Explorer::setTopicData(QTreeWidgetItem* item, TopicData data)
+void Explorer::reloadSequenceStatistics()
 {
-    item->setData(0, Qt::UserRole, qVariantFromValue<TopicData>(data));
-}
+    if(!sequenceTracking)
+        return;
 
-TopicData Explorer::getTopicData(QTreeWidgetItem* item)
-{
-    return qvariant_cast<TopicData>(item->data(0, Qt::UserRole));
+    labelSequenceStatistics->setText(QString("Sequence: %1 missing, %2 duplicates, %3 reordered, %4 restarts")
+        .arg(sequenceTotals.missing).arg(sequenceTotals.duplicates).arg(sequenceTotals.reordered).arg(sequenceTotals.restarts));
 }
 
 QTreeWidgetItem* Explorer::getSelectedTopic()
@@ -332,7 +1286,7 @@ void Explorer::reloadToggleButton()
     auto topicData = getTopicData(selected);
     
     // Change toggle button text based on topic subscription status
-    if(topicData.isSubscribed)
+    if(topicData->isSubscribed)
         buttonToggleSubscribe->setText("Unsubscribe selected topic");
     else
         buttonToggleSubscribe->setText("Subscribe selected topic");
@@ -354,31 +1308,226 @@ void Explorer::reloadMessageList()
 
     auto topicData = getTopicData(selected);
 
-    // Iterate whole message history and create new items
-    for(auto message : topicData.messages)
+    // Messages in memory are listed whole, spilled ones page by page
+    for(auto &message : topicData->messages)
+        addMessageItem(message);
+
+    loadMessagePage();
+}
+
+void Explorer::loadMessagePage()
+{
+    auto selected = getSelectedTopic();
+
+    if(selected == Q_NULLPTR)
+        return;
+
+    auto topicData = getTopicData(selected);
+
+    // Rows after messages in memory map to spilled messages in the same order
+    auto start = std::max(0, topicMessageList->count() - topicData->messages.length());
+    auto end = std::min(start + messagePageSize, topicData->spilled.length());
+
+    for(auto i = start; i < end; i++)
     {
-        auto data = std::get<0>(message);
-        auto time = std::get<2>(message);
+        auto &ref = topicData->spilled[i];
 
-        auto message_item = new QListWidgetItem();
-        message_item->setData(Qt::UserRole, data);
+        TopicMessage message;
+        message.payload = historyStore.read(ref);
+        message.isImage = ref.isImage;
+        message.local = ref.local;
+        message.time = QDateTime::fromMSecsSinceEpoch(ref.time);
 
-        auto text = time.toString("HH:mm:ss") + ": ";
+        addMessageItem(message);
+    }
+}
 
-        // Only string and image type is supported
-        if(data.userType() == QMetaType::QString)
-            text += qvariant_cast<QString>(data).simplified();
-        else if(data.userType() == QMetaType::QPixmap)
-            text += "[Image]";
+void Explorer::addMessageItem(const TopicMessage &message, int row)
+{
+    auto time = message.time;
 
-        message_item->setText(text);
+    // Item keeps only raw payload, delegate draws its thumbnail and full image is decoded when opened
+    auto message_item = new QListWidgetItem();
+    message_item->setData(ThumbnailDelegate::payloadRole, message.payload);
+    message_item->setData(ThumbnailDelegate::imageRole, message.isImage);
+    message_item->setData(Qt::UserRole + 2, message.id);
 
-        // Set color based on the sender of message (1) us (2) anyone else
-        auto color = std::get<1>(message) ? QColor(255, 255, 0, 127) : QColor(0, 0, 0, 0);
-        message_item->setBackgroundColor(color);
+    if(message.isImage)
+        message_item->setData(ThumbnailDelegate::thumbnailRole, Utils::hashPayload(message.payload));
 
+    auto text = time.toString("HH:mm:ss") + ": ";
+
+    // Delegate appends preview of text payload when the row is painted
+    if(message.isImage)
+        text += "[Image]";
+
+    message_item->setText(text);
+
+    // Set color based on the sender of message (1) us (2) anyone else
+    auto color = message.local ? QColor(255, 255, 0, 127) : QColor(0, 0, 0, 0);
+    message_item->setBackgroundColor(color);
+
+    if(row < 0)
         topicMessageList->addItem(message_item);
+    else
+        topicMessageList->insertItem(row, message_item);
+}
+
+void Explorer::onThumbnailReady(quint64 key)
+{
+    Q_UNUSED(key);
+
+    // Repaints are merged, so many thumbnails decoded at once cost one repaint
+    topicMessageList->viewport()->update();
+    topicTree->viewport()->update();
+}
+
+void Explorer::onMemoryColumnsToggled(bool checked)
+{
+    for(auto column = 3; column <= 5; column++)
+        topicTree->setColumnHidden(column, !checked);
+
+    if(checked)
+        memoryTimer.start(1000);
+    else
+        memoryTimer.stop();
+}
+
+void Explorer::onMemoryTimeout()
+{
+    // Totals are kept current by accounts, rows in viewport are repainted with them
+    topicTree->viewport()->update();
+}
+
+void Explorer::onRateColumnsToggled(bool checked)
+{
+    for(auto column = 6; column <= 7; column++)
+        topicTree->setColumnHidden(column, !checked);
+
+    if(checked)
+    {
+        onRateTimeout();
+        rateTimer.start(1000);
+    }
+    else
+        rateTimer.stop();
+}
+
+void Explorer::onRateTimeout()
+{
+    auto now = rateClock.elapsed();
+
+    // Only topics that received messages since the last roll up walk to the root
+    for(auto topicData : pendingRates)
+        topicData->rate.rollUp(now);
+
+    pendingRates.clear();
+
+    // Rates decay even without messages, so rows in viewport are repainted
+    topicTree->viewport()->update();
+}
+
+void Explorer::onSearchTextChanged(QString query)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    auto results = searchIndex.find(query, maxSearchResults);
+    auto elapsed = timer.elapsed();
+
+    treeSearchResults->setUpdatesEnabled(false);
+    treeSearchResults->clear();
+
+    QList<QTreeWidgetItem*> items;
+    for(auto &result : results)
+    {
+        auto item = new QTreeWidgetItem();
+        item->setText(0, result.document.topic);
+        item->setText(1, QDateTime::fromMSecsSinceEpoch(result.document.time).toString("HH:mm:ss"));
+        item->setText(2, result.document.text.simplified());
+
+        // Match may also lie in the part of the message that is not indexed
+        if(result.document.truncated)
+        {
+            item->setText(2, item->text(2) + " [truncated]");
+            item->setToolTip(2, QString("Only the first %1 characters of this message are searchable").arg(SearchIndex::maxTextLength));
+        }
+
+        items.append(item);
+    }
+
+    treeSearchResults->addTopLevelItems(items);
+    treeSearchResults->setUpdatesEnabled(true);
+
+    if(!query.isEmpty())
+        setStatus(QString("Found %1 of %2 messages in %3 ms").arg(results.count()).arg(searchIndex.count()).arg(elapsed));
+}
+
+void Explorer::onSearchResultDoubleClicked(QTreeWidgetItem *item, int column)
+{
+    Q_UNUSED(column);
+
+    // Topic may have been removed since the search
+    auto topicData = topics.value(item->text(0), Q_NULLPTR);
+
+    if(topicData == Q_NULLPTR)
+        return;
+
+    tabWidget->setCurrentIndex(0);
+    revealTopic(topicData);
+    topicTree->setCurrentItem(topicData->widgetItem);
+    topicTree->scrollToItem(topicData->widgetItem);
+}
+
+void Explorer::connectTo(QString address)
+{
+    inputServerAddress->setText(address);
+    onConnectButtonClicked();
+}
+
+void Explorer::setMemoryReport(QString fileName)
+{
+    memoryReport = fileName;
+    memoryReportTimer.start(memoryReportInterval);
+}
+
+void Explorer::onMemoryReportTimeout()
+{
+    if(!writeMemoryReport(memoryReport))
+        qWarning("Could not write memory report %s", qPrintable(memoryReport));
+}
+
+bool Explorer::writeMemoryReport(QString fileName)
+{
+    auto list = topics.values();
+
+    std::sort(list.begin(), list.end(), [](TopicData *a, TopicData *b) {
+        return a->memory.subtreeRaw + a->memory.subtreeDecoded > b->memory.subtreeRaw + b->memory.subtreeDecoded;
+    });
+
+    QByteArray report = "topic,raw_bytes,decoded_bytes,messages,spilled,subtree_raw_bytes,subtree_decoded_bytes,subtree_messages,subtree_spilled\n";
+
+    for(auto topicData : list)
+    {
+        auto &memory = topicData->memory;
+        auto path = topicData->path;
+
+        // Quote path, topic names can contain commas and quotes
+        report += "\"" + path.replace("\"", "\"\"").toUtf8() + "\"";
+        report += QString(",%1,%2,%3,%4,%5,%6,%7,%8\n")
+            .arg(memory.raw).arg(memory.decoded).arg(memory.messages).arg(memory.spilled)
+            .arg(memory.subtreeRaw).arg(memory.subtreeDecoded).arg(memory.subtreeMessages).arg(memory.subtreeSpilled)
+            .toUtf8();
     }
+
+    return Utils::writeFile(fileName, report);
+}
+
+void Explorer::onMessageListScrolled(int value)
+{
+    // Older messages are loaded when the end of the list is reached
+    if(value == topicMessageList->verticalScrollBar()->maximum())
+        loadMessagePage();
 }
 
 void Explorer::onToggleSubscribeButtonClicked()
@@ -391,9 +1540,9 @@ void Explorer::onToggleSubscribeButtonClicked()
     auto topicData = getTopicData(selected);
 
     // If selected topic was subscribed, unsubscribe it
-    if(topicData.isSubscribed)
+    if(topicData->isSubscribed)
     {
-        topicData.isSubscribed = false;
+        topicData->isSubscribed = false;
         //client->unsubscribe(selected->text(2).toStdString());
         client->unsubscribe(selected->text(2));
         setStatus("Topic unsubscribed", 3);
@@ -403,7 +1552,7 @@ void Explorer::onToggleSubscribeButtonClicked()
     //If selected topic was unsubscribed, subscribe it
     else 
     {
-        topicData.isSubscribed = true;
+        topicData->isSubscribed = true;
         //client->subscribe(selected->text(2).toStdString(), 1, mqtt::subscribe_options(true));
         client->subscribe(selected->text(2));
         setStatus("Topic subscribed", 3);
@@ -411,20 +1560,45 @@ void Explorer::onToggleSubscribeButtonClicked()
         selected->setForeground(0, QBrush(Qt::blue));
     }
 
-    setTopicData(selected, topicData);
     reloadToggleButton();
 }
 
 void Explorer::onMessageDoubleClicked(QListWidgetItem* item)
 {
-    auto data = item->data(Qt::UserRole);
+    auto payload = item->data(ThumbnailDelegate::payloadRole).toByteArray();
 
-    if(data.userType() == QMetaType::QString)
-        Utils::openText(qvariant_cast<QString>(data), this);
-    else if(data.userType() == QMetaType::QPixmap)
-        Utils::openImage(qvariant_cast<QPixmap>(data), this);
-    else
+    if(!item->data(ThumbnailDelegate::imageRole).toBool())
+    {
+        Utils::openPayload(payload, this);
         return;
+    }
+
+    // Decoded image may have been evicted, decode it again from the raw payload
+    auto id = item->data(Qt::UserRole + 2).toULongLong();
+    auto pixmap = payloadCache.find(id);
+
+    if(pixmap.isNull())
+    {
+        if(!pixmap.loadFromData(payload))
+            return;
+
+        // Only messages still in memory are cached, spilled ones would never be released
+        auto selected = getSelectedTopic();
+        if(selected != Q_NULLPTR)
+        {
+            auto topicData = getTopicData(selected);
+            for(auto &message : topicData->messages)
+            {
+                if(message.id == id)
+                {
+                    payloadCache.insert(id, pixmap, &topicData->memory);
+                    break;
+                }
+            }
+        }
+    }
+
+    Utils::openImage(pixmap, this);
 }
 
 void Explorer::onPublishButtonClicked()
@@ -460,64 +1634,241 @@ void Explorer::onPublishFileButtonClicked()
 
 void Explorer::onSaveStateButtonClicked()
 {
+    if(snapshot->isRunning())
+    {
+        setStatus("Snapshot is already being saved");
+        return;
+    }
+
     // Open directory where will be directory structure generated
     auto path = QFileDialog::getExistingDirectory(this, "Select Directory", "", QFileDialog::ShowDirsOnly | QFileDialog::DontResolveSymlinks);
 
     if(path.isEmpty())
         return;
 
-    auto directory = QDir(path);
-    auto iterator = QTreeWidgetItemIterator(topicTree);
+    // Directory that already holds snapshot from this session gets only changed topics
+    auto entries = buildSnapshotEntries(snapshotGenerations.value(path, 0));
+
+    snapshotTarget = path;
+    snapshotGeneration = generation;
+    snapshotArchive = false;
+
+    snapshotProgress->setMaximum(entries.count());
+    snapshotProgress->setValue(0);
+    snapshotProgress->show();
+
+    snapshot->start(path, entries);
+    setStatus("Saving snapshot...", 0);
+}
+
+void Explorer::onSaveArchiveButtonClicked()
+{
+    if(snapshot->isRunning())
+    {
+        setStatus("Snapshot is already being saved");
+        return;
+    }
+
+    auto fileName = QFileDialog::getSaveFileName(this, "Save snapshot archive", "", "Snapshot archive (*.mqea);;All files (*)");
+
+    if(fileName.isEmpty())
+        return;
 
-    // Iterate all topics one by one
-    while(*iterator) 
+    // Offer delta against the last archive, it stores only topics changed since then
+    QString base;
+    quint64 since = 0;
+    if(!lastArchive.isEmpty() && lastArchive != fileName && QFile::exists(lastArchive))
     {
-        auto topicPath = (*iterator)->text(2);
-        auto topicData = getTopicData(*iterator);
+        auto answer = QMessageBox::question(this, "Save snapshot archive", 
+            "Save only topics changed since " + QFileInfo(lastArchive).fileName() + "?\n"
+            "The archive will need that archive to be opened.");
 
-        if(!directory.mkpath(topicPath))
+        if(answer == QMessageBox::Yes)
         {
-            setStatus("Could not create directory sructure");
-            return;
+            base = QFileInfo(fileName).absoluteDir().relativeFilePath(lastArchive);
+            since = snapshotGenerations.value(lastArchive, 0);
         }
+    }
 
-        // If the topic did not receive any message, we can skip it
-        if(topicData.messages.count() == 0)
-        {
-            ++iterator;
+    auto entries = buildSnapshotEntries(since);
+
+    snapshotTarget = fileName;
+    snapshotGeneration = generation;
+    snapshotArchive = true;
+
+    snapshotProgress->setMaximum(entries.count());
+    snapshotProgress->setValue(0);
+    snapshotProgress->show();
+
+    snapshot->startArchive(fileName, entries, base);
+    setStatus("Saving snapshot archive...", 0);
+}
+
+QVector<SnapshotEntry> Explorer::buildSnapshotEntries(quint64 since)
+{
+    // Build work list here, payloads are implicitly shared so this does not copy message data
+    QVector<SnapshotEntry> entries;
+    entries.reserve(topics.count());
+
+    for(auto topicData : topics)
+    {
+        if(topicData->changed <= since)
             continue;
+
+        SnapshotEntry entry;
+        entry.path = topicData->path;
+
+        // If the topic did not receive any message, only its directory is created
+        if(!topicData->messages.isEmpty())
+        {
+            auto &message = topicData->messages.first();
+            entry.hasMessage = true;
+            entry.payload = message.payload;
+            entry.isImage = message.isImage;
+            entry.local = message.local;
+            entry.time = message.time.toMSecsSinceEpoch();
         }
 
-        auto message = topicData.messages.first();
+        entries.append(entry);
+    }
+
+    return entries;
+}
+
+void Explorer::onOpenArchiveButtonClicked()
+{
+    // Running export may still read payloads of the currently opened archive
+    if(snapshot->isRunning())
+    {
+        setStatus("Wait until the snapshot is saved");
+        return;
+    }
+
+    auto fileName = QFileDialog::getOpenFileName(this, "Open snapshot archive", "", "Snapshot archive (*.mqea);;All files (*)");
+
+    if(fileName.isEmpty())
+        return;
+
+    QList<QFile*> files;
+    QList<QVector<SnapshotEntry>> chain;
+
+    if(!readArchiveChain(fileName, files, chain))
+    {
+        qDeleteAll(files);
+        setStatus("Could not read snapshot archive or some of its base archives");
+        return;
+    }
+
+    // Topics of previous archive are removed before its mapping is released,
+    // thumbnail workers may still decode payloads that point into it
+    clearTopics();
+    clearDashboard();
+    thumbnailCache->clear();
+    qDeleteAll(archives);
+    archives = files;
+
+    topicTree->setUpdatesEnabled(false);
 
-        auto data = std::get<0>(message);
+    // Apply the oldest base first, topics of newer deltas replace it
+    QSet<QString> loaded;
+    for(auto i = chain.count() - 1; i >= 0; i--)
+    for(auto &entry : chain[i])
+    {
+        auto topicData = createTopic(entry.path);
+        loaded.insert(entry.path);
+
+        if(topicData == Q_NULLPTR || !entry.hasMessage)
+            continue;
 
-        // If the message is string, create text stream to txt file
-        if(data.userType() == QMetaType::QString)
+        for(auto &previous : topicData->messages)
         {
-            if(!Utils::writeFile(path + "/" + topicPath + "/payload.txt", qvariant_cast<QString>(data).toUtf8()))
-            {
-                setStatus("Failed to write to file");
-                return;
-            }
+            releaseMessage(topicData, previous);
+            unindexMessage(topicData, previous.id);
         }
-        // If the message is image, save it in JPG format
-        else if(data.userType() == QMetaType::QPixmap)
-        {
-            QFile file(path + "/" + topicPath + "/payload.jpg");
 
-            if(!file.open(QIODevice::ReadWrite))
-            {
-                setStatus("Failed to write to file");
-                return;
-            }
+        topicData->messages.clear();
+        topicData->hash = Utils::hashPayload(entry.payload);
 
-            qvariant_cast<QPixmap>(data).save(&file, "JPG");
-            file.close();
-        }
+        // Images are decoded when opened
+        TopicMessage message;
+        message.id = ++lastMessageId;
+        message.payload = entry.payload;
+        message.isImage = entry.isImage;
+        message.local = entry.local;
+        message.time = QDateTime::fromMSecsSinceEpoch(entry.time);
+        topicData->messages.prepend(message);
+        topicData->memory.count(1, 0);
+        payloadCache.addRaw(&topicData->memory, messageCost(message));
+
+        if(!message.isImage)
+            indexMessage(topicData, message.id, entry.path, QString::fromUtf8(entry.payload.left(SearchIndex::maxTextLength * 4)), entry.time);
+
+        markTopicDirty(topicData);
+    }
+
+    topicTree->setUpdatesEnabled(true);
+
+    // Next archive can be saved as delta of the opened one
+    lastArchive = fileName;
+    snapshotGenerations[fileName] = generation;
+
+    // Archive can be browsed without connection to the server
+    tabWidget->setEnabled(true);
+    setStatus(QString("Opened snapshot archive with %1 topics").arg(loaded.count()));
+}
+
+bool Explorer::readArchiveChain(QString fileName, QList<QFile*> &files, QList<QVector<SnapshotEntry>> &entries)
+{
+    // Limit depth, so cyclic references can not loop forever
+    for(auto depth = 0; depth < 256; depth++)
+    {
+        auto file = new QFile(fileName);
+        files.append(file);
+
+        QVector<SnapshotEntry> archiveEntries;
+        QString base;
+
+        if(!file->open(QIODevice::ReadOnly) || !Snapshot::readArchive(file, archiveEntries, base))
+            return false;
+
+        entries.append(archiveEntries);
+
+        if(base.isEmpty())
+            return true;
+
+        // Base is stored relative to the delta archive
+        fileName = QFileInfo(fileName).absoluteDir().absoluteFilePath(base);
+    }
+
+    return false;
+}
+
+void Explorer::onSnapshotProgress(int done, int total)
+{
+    snapshotProgress->setMaximum(total);
+    snapshotProgress->setValue(done);
+}
+
+void Explorer::onSnapshotFinished(int written, int failed, bool cancelled)
+{
+    snapshotProgress->reset();
+    snapshotProgress->hide();
+
+    // Next snapshot to the same target can skip topics that did not change since
+    if(!cancelled && failed == 0)
+    {
+        snapshotGenerations[snapshotTarget] = snapshotGeneration;
 
-        ++iterator;
+        if(snapshotArchive)
+            lastArchive = snapshotTarget;
     }
+
+    if(cancelled)
+        setStatus(QString("Saving snapshot was cancelled after %1 topics").arg(written));
+    else if(failed > 0)
+        setStatus(QString("Failed to write %1 of %2 topics").arg(failed).arg(written + failed));
+    else
+        setStatus(QString("Snapshot of %1 topics saved").arg(written));
 }
 
 // SIMULATOR
@@ -530,10 +1881,12 @@ void Explorer::onToggleSimulatorButtonClicked()
             buttonToggleSimulator->setText("Stop simulator");
     }
     else
-    {
         simulator->stop();
-        buttonToggleSimulator->setText("Start simulator on this server");
-    }
+}
+
+void Explorer::onSimulatorStopped()
+{
+    buttonToggleSimulator->setText("Start simulator on this server");
 }
 
 // DASHBOARD
@@ -566,6 +1919,9 @@ void Explorer::onLoadDashboardButtonClicked()
 
     clearDashboard();
 
+    // Widgets subscribe their topics while rendering, they are sent together once all widgets are loaded
+    client->beginBatch();
+
     auto array = document.object().value("widgets").toArray();
     for(auto widget : array)
     {
@@ -580,12 +1936,23 @@ void Explorer::onLoadDashboardButtonClicked()
         if(!newWidget->Setup(widget.toObject()) || !newWidget->Render()) 
         {
             delete newWidget;
-            return;
+            break;
         }
 
         widgets.append(newWidget);
         flowLayout->addWidget(newWidget);
     }
+
+    client->endBatch();
+}
+
+void Explorer::updateWidgetVisibility()
+{
+    // Part of dashboard shown in scroll area, in coordinates of the dashboard
+    auto visible = QRect(-scrollAreaWidgetContents_2->pos(), scrollArea->viewport()->size());
+
+    for(auto widget : widgets)
+        widget->setOffscreen(!widget->geometry().intersects(visible));
 }
 
 void Explorer::onSaveDashboardButtonClicked()
@@ -620,12 +1987,45 @@ void Explorer::removeWidget(Widget *widget)
     delete widget;
 }
 
+void Explorer::chargeWidgetMemory(QString topic, qint64 bytes)
+{
+    if(bytes == 0)
+        return;
+
+    auto held = widgetMemory.value(topic, 0) + bytes;
+    if(held == 0)
+        widgetMemory.remove(topic);
+    else
+        widgetMemory.insert(topic, held);
+
+    // Topics are released on reconnect, widget memory is charged again once its topic is created
+    auto topicData = topics.value(topic, Q_NULLPTR);
+    if(topicData == Q_NULLPTR)
+        return;
+
+    if(bytes > 0)
+        payloadCache.addRaw(&topicData->memory, bytes);
+    else
+        payloadCache.removeRaw(&topicData->memory, -bytes);
+}
+
 Explorer::~Explorer()
 {
+    // Final memory report of the session
+    if(!memoryReport.isEmpty())
+        writeMemoryReport(memoryReport);
+
     delete client;
     delete simulator;
     delete flowLayout;
 
+    // Export workers must finish before payloads they reference are released
+    delete snapshot;
+
     for(auto widget : widgets)
         delete widget;
+
+    qDeleteAll(topics);
+    thumbnailCache->clear();
+    qDeleteAll(archives);
 }
\ No newline at end of file
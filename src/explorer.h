@@ -11,36 +11,142 @@
 #include "ui_explorer.h"
 
 #include <QMap>
+#include <QFile>
+#include <QSet>
+#include <QHash>
 #include <QList>
+#include <QTimer>
 #include <QWidget>
 #include <QString>
 #include <QVariant>
 #include <QDateTime>
+#include <QElapsedTimer>
+#include <QStringList>
 #include <QByteArray>
+#include <QLabel>
 #include <QMainWindow>
+#include <QProgressDialog>
 #include <QTreeWidgetItem>
 #include <QListWidgetItem>
 
 #include "widgets/widget.h"
 #include "simulator.h"
+#include "history_store.h"
+#include "payload_cache.h"
+#include "topic_rate.h"
+#include "thumbnail_cache.h"
+#include "search_index.h"
+#include "json_path.h"
+#include "snapshot.h"
 #include "client.h"
 
+//! Sequence number tracking of one topic
+class SequenceState
+{
+public:
+    //! Whether any sequence number was received
+    bool valid = false;
+
+    //! Highest sequence number received
+    qint64 last = 0;
+
+    //! Number of sequence numbers that were skipped and did not arrive later
+    quint64 missing = 0;
+
+    //! Number of messages with already received sequence number
+    quint64 duplicates = 0;
+
+    //! Number of messages with sequence number lower than already received one
+    quint64 reordered = 0;
+
+    //! Number of detected counter restarts
+    quint64 restarts = 0;
+
+    //! Number of consecutive increasing messages below the highest number, candidates for restart
+    int lowerRun = 0;
+
+    //! Last number of the run below the highest number
+    qint64 runLast = 0;
+
+    //! Number of missing numbers the run filled as late messages
+    quint64 runFilled = 0;
+};
+
+//! Message stored in topic history
+class TopicMessage
+{
+public:
+    //! Id of message, key of its decoded image in payload cache
+    quint64 id = 0;
+
+    //! Raw payload, text is decoded only for preview or when opened, images are kept in payload cache
+    QByteArray payload;
+
+    //! Whether the payload is an image
+    bool isImage = false;
+
+    //! Whether the message was sent from us
+    bool local = false;
+
+    //! Time the message was received
+    QDateTime time;
+};
+
 //! Stores information about topic
 class TopicData
 {
 public:
-    //! History of received messages
-    QList<std::tuple<QVariant, bool, QDateTime>> messages;
+    //! Newest messages of history kept in memory, the newest first
+    QList<TopicMessage> messages;
+
+    //! Older messages of history spilled to disk, the newest first
+    QList<HistoryRef> spilled;
+
+    //! Payload memory used by messages in memory
+    PayloadAccount memory;
+
+    //! Message and byte rates of the topic and its subtree
+    TopicRate rate;
+
+    //! Last segment of topic path
+    QString name;
 
-    //! TreeWidget the topic is associated with
-    QTreeWidgetItem *widgetItem;
+    //! Topic path
+    QString path;
+
+    //! TreeWidget the topic is associated with, null while its parent is collapsed
+    QTreeWidgetItem *widgetItem = Q_NULLPTR;
+
+    //! Parent topic, null for top level topics
+    TopicData *parent = Q_NULLPTR;
+
+    //! Child topics in order of creation
+    QList<TopicData*> children;
+
+    //! Number of path segments above the topic
+    int depth = 0;
+
+    //! Number of all topics in subtree without the topic itself
+    quint64 descendants = 0;
+
+    //! Whether the topic was expanded automatically, not by the user
+    bool autoExpanded = false;
+
+    //! Whether the user collapsed the topic, it is not expanded automatically again
+    bool userCollapsed = false;
 
     //! If the topic is subscribed
     bool isSubscribed = false;
-};
 
-//! Register TopicData as metatype
-Q_DECLARE_METATYPE(TopicData);
+    //! Sequence number tracking, used only when sequence field is configured
+    SequenceState sequence;
+
+    //! Hash of the last payload
+    quint64 hash = 0;
+
+    //! Generation in which the topic was created or its last payload changed
+    quint64 changed = 0;
+};
 
 // Forward declarations
 class Client;
@@ -49,6 +155,50 @@ class Explorer;
 class Simulator;
 class FlowLayout;
 
+/*!
+ * @brief Draws rows of topic tree from the current state of their topics
+ *
+ * Tree items hold only topic names, values, colors and tooltips are read from TopicData when a row is painted,
+ * so a changed topic only needs its row repainted and the model does not emit a change per message.
+ */
+class TopicDelegate : public ThumbnailDelegate
+{
+    Q_OBJECT
+
+public:
+    /*!
+     * @brief Constructor
+     * @param explorer Explorer owning the topics
+     * @param cache Thumbnail cache
+     * @param height Height of drawn thumbnails, all rows are this high
+     * @param parent Parent object
+     */
+    TopicDelegate(Explorer *explorer, ThumbnailCache *cache, int height, QObject *parent);
+
+    //! Rows are tall enough for thumbnail, so a topic changing from text to image does not change layout
+    QSize sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+
+    //! Show tooltip built from the current state of topic
+    bool helpEvent(QHelpEvent *event, QAbstractItemView *view, const QStyleOptionViewItem &option, const QModelIndex &index) override;
+
+    //! Role of the first column holding pointer to topic data
+    static constexpr int topicRole = Qt::UserRole + 4;
+
+protected:
+    //! Fill texts and colors from topic data
+    void initStyleOption(QStyleOptionViewItem *option, const QModelIndex &index) const override;
+
+    //! Provide the newest message of topic instead of item data
+    QVariant itemData(const QModelIndex &index, int role) const override;
+
+private:
+    //! Explorer owning the topics
+    Explorer *explorer;
+
+    //! Height of rows
+    int height;
+};
+
 //! Helper for WidgetFactory functionality
 struct IWidgetFactory { 
     //! Create widget by type
@@ -72,9 +222,14 @@ public:
     /*!
      * @brief Constructor
      * @param history How many messages to keep in the history
+     * @param memoryHistory How many of the newest messages of each topic to keep in memory
+     * @param memoryBudget How many bytes payloads and decoded images of all topics can use
+     * @param inflight How many published messages can wait for acknowledgement at once
+     * @param qos QoS of published messages
+     * @param sequenceField JSON path of sequence number in payloads ("$" for whole payload), empty to turn tracking off
      * @param parent Parent widget
      */
-    Explorer(int history, QWidget *parent = Q_NULLPTR);
+    Explorer(int history, int memoryHistory, qint64 memoryBudget, int inflight, int qos, QString sequenceField, QWidget *parent = Q_NULLPTR);
     
     //! Destructor
     ~Explorer();
@@ -87,6 +242,41 @@ public:
      */
     int subscribeTopic(QString topic, QTreeWidgetItem *root = Q_NULLPTR);
 
+    /*!
+     * @brief Subscribe all topics of subscription list
+     * @param data Subscription list, one topic per line
+     * @returns number of newly subscribed topics
+     */
+    int importSubscriptions(QByteArray data);
+
+    /*!
+     * @brief Create subscription list of all subscribed topics
+     * @returns subscription list, one topic per line
+     */
+    QByteArray exportSubscriptions();
+
+    /*!
+     * @brief Connect to server as if the user clicked connect button
+     * @param address Server address
+     */
+    void connectTo(QString address);
+
+    /*!
+     * @brief Write memory report of all topics to CSV file periodically and when the explorer is closed
+     * @param fileName Report file name
+     */
+    void setMemoryReport(QString fileName);
+
+    /*!
+     * @brief Write memory report of all topics to CSV file, topics using the most memory first
+     * @param fileName Report file name
+     * @returns true on success, false otherwise
+     */
+    bool writeMemoryReport(QString fileName);
+
+    //! How often is memory report written (in milliseconds)
+    static constexpr int memoryReportInterval = 10000;
+
     /*!
      * @brief Publish text to topic
      * @param topic Topic name
@@ -114,6 +304,25 @@ public:
      */
     void removeWidget(Widget *widget);
 
+    /*!
+     * @brief Charge memory held by dashboard widget to the memory budget and to the topic it shows
+     * @param topic Topic the memory belongs to
+     * @param bytes Change of held bytes, negative when memory is released
+     */
+    void chargeWidgetMemory(QString topic, qint64 bytes);
+
+    /*!
+     * @brief Get size of inflight window for published messages
+     * @returns How many published messages can wait for acknowledgement at once
+     */
+    int getInflight();
+
+    /*!
+     * @brief Get QoS of published messages
+     * @returns QoS (0, 1 or 2)
+     */
+    int getPublishQos();
+
 private slots:
     //! This slot is called when publish text button is clicked
     void onPublishButtonClicked();
@@ -124,6 +333,12 @@ private slots:
     //! This slot is called when save state button is clicked
     void onSaveStateButtonClicked();
 
+    //! This slot is called when save archive button is clicked
+    void onSaveArchiveButtonClicked();
+
+    //! This slot is called when open archive button is clicked
+    void onOpenArchiveButtonClicked();
+
     //! This slot is called when subscribe button is clicked
     void onSubscribeButtonClicked();
 
@@ -139,6 +354,9 @@ private slots:
     //! This slot is called when load dashboard button is clicked
     void onLoadDashboardButtonClicked();
 
+    //! This slot is called when dashboard is scrolled or its widgets are placed, marks widgets out of view as offscreen
+    void updateWidgetVisibility();
+
     //! This slot is called when toggle simulator button is clicked
     void onToggleSimulatorButtonClicked();
 
@@ -154,40 +372,276 @@ private slots:
      */
     void onMessageDoubleClicked(QListWidgetItem* item);
 
+    /*!
+     * @brief This slot is called when message history is scrolled, older messages are loaded at the end
+     * @param value Scroll bar position
+     */
+    void onMessageListScrolled(int value);
+
+    /*!
+     * @brief This slot is called when thumbnail is decoded, views draw it on the next repaint
+     * @param key Thumbnail key
+     */
+    void onThumbnailReady(quint64 key);
+
+    /*!
+     * @brief This slot is called when memory columns are turned on or off
+     * @param checked Whether the columns are shown
+     */
+    void onMemoryColumnsToggled(bool checked);
+
+    //! This slot is called periodically to refresh memory columns
+    void onMemoryTimeout();
+
+    /*!
+     * @brief This slot is called when rate columns are turned on or off
+     * @param checked Whether the columns are shown
+     */
+    void onRateColumnsToggled(bool checked);
+
+    //! This slot is called periodically to roll up subtree rates and refresh rate columns
+    void onRateTimeout();
+
+    //! This slot is called periodically to write memory report
+    void onMemoryReportTimeout();
+
+    /*!
+     * @brief This slot is called when search query changes
+     * @param query Query
+     */
+    void onSearchTextChanged(QString query);
+
+    /*!
+     * @brief This slot is called when user double clicks search result, its topic is selected
+     * @param item Result item
+     * @param column Clicked column
+     */
+    void onSearchResultDoubleClicked(QTreeWidgetItem *item, int column);
+
+    /*!
+     * @brief This slot is called when topic is expanded, its children get tree items
+     * @param item Tree item
+     */
+    void onTopicExpanded(QTreeWidgetItem *item);
+
+    /*!
+     * @brief This slot is called when topic is collapsed, tree items of its descendants are released
+     * @param item Tree item
+     */
+    void onTopicCollapsed(QTreeWidgetItem *item);
+
+    //! This slot is called once per frame to repaint visible tree rows of changed topics
+    void flushDirtyTopics();
+
+    /*!
+     * @brief This slot is called when topic filter changes
+     * @param filter Substring of topic name or MQTT pattern
+     */
+    void onTopicFilterChanged(QString filter);
+
     //! This slot is called when widget add button is clicked
     void onAddWidgetButtonClicked();
 
     /*!
      * @brief This slot is called when client receives new message
      * @param topic Topic
-     * @param data Image or string
+     * @param payload Raw payload
+     * @param isImage Whether the payload is image
      * @param local Whether the message was sent from us
      */
-    void onReceivedMessage(QString topic, QVariant data, bool local);
+    void onReceivedMessage(QString topic, QByteArray payload, bool isImage, bool local);
+
+    //! This slot is called when delivery counters of client change
+    void onPublishStatisticsChanged();
+
+    /*!
+     * @brief This slot is called when client establishes connection
+     * @param reconnected Whether the connection was established again after it was lost
+     */
+    void onClientConnected(bool reconnected);
+
+    //! This slot is called when first connection attempt of client fails
+    void onClientConnectionFailed();
+
+    /*!
+     * @brief This slot is called when client lost connection and tries to reconnect
+     * @param seconds Delay before next connection attempt
+     */
+    void onClientReconnecting(int seconds);
+
+    //! This slot is called when import subscriptions button is clicked
+    void onImportSubscriptionsButtonClicked();
+
+    //! This slot is called when export subscriptions button is clicked
+    void onExportSubscriptionsButtonClicked();
+
+    /*!
+     * @brief This slot is called when server answers subscription request
+     * @param accepted Number of topics the server accepted
+     * @param rejected Topics the server rejected
+     */
+    void onClientSubscribeCompleted(int accepted, QStringList rejected);
+
+    //! This slot is called when simulator stops
+    void onSimulatorStopped();
+
+    /*!
+     * @brief This slot is called when snapshot export writes more topics
+     * @param done Number of processed topics
+     * @param total Number of topics
+     */
+    void onSnapshotProgress(int done, int total);
+
+    /*!
+     * @brief This slot is called when snapshot export finishes
+     * @param written Number of written topics
+     * @param failed Number of topics that could not be written
+     * @param cancelled Whether the user cancelled the export
+     */
+    void onSnapshotFinished(int written, int failed, bool cancelled);
 
 signals:
     /*!
      * @brief Signal that new message was received
      * @param topic Topic
-     * @param data Image or string
+     * @param payload Raw payload
+     * @param isImage Whether the payload is image
      * @param local Whether the message was sent from us
      */
-    void messageReceived(QString topic, QVariant data, bool local);
+    void messageReceived(QString topic, QByteArray payload, bool isImage, bool local);
+
+    //! Signal that connection to server could not be established
+    void connectionFailed();
     
 private:
-    /*!
-     * @brief Update topic data for tree item
-     * @param item tree item
-     * @param data data
-     */
-    void setTopicData(QTreeWidgetItem* item, TopicData data);
+    //! Delegate reads topic data when painting
+    friend class TopicDelegate;
 
     /*!
      * @brief Get topic data from tree item
      * @param item tree item
      * @returns topic data
      */
-    TopicData getTopicData(QTreeWidgetItem* item);
+    TopicData* getTopicData(QTreeWidgetItem* item);
+
+    //! Remove all topics from topic tree
+    void clearTopics();
+
+    /*!
+     * @brief Find topic or create it with all missing parent topics
+     * @param topic Topic name
+     * @param root Topic name is relative to which treeItem
+     * @returns topic data, null if topic name is empty
+     */
+    TopicData* createTopic(QString topic, QTreeWidgetItem *root = Q_NULLPTR);
+
+    /*!
+     * @brief Create tree item of topic, the caller adds it to the tree
+     * @param topicData Topic data
+     * @returns tree item
+     */
+    QTreeWidgetItem* materializeTopic(TopicData *topicData);
+
+    /*!
+     * @brief Create tree items of children that do not have one yet
+     * @param topicData Expanded topic
+     */
+    void materializeChildren(TopicData *topicData);
+
+    /*!
+     * @brief Forget tree items of all descendants, the caller deletes the items
+     * @param topicData Collapsed topic
+     */
+    void dematerializeChildren(TopicData *topicData);
+
+    /*!
+     * @brief Expand topic and all its ancestors so its tree item exists
+     * @param topicData Topic data
+     */
+    void revealTopic(TopicData *topicData);
+
+    /*!
+     * @brief Get topic data of topic tree row
+     * @param index Model index of any column of the row
+     * @returns topic data, null if the row has no topic
+     */
+    TopicData* getTopicData(const QModelIndex &index);
+
+    /*!
+     * @brief Fill text and colors of topic tree cell from current state of topic
+     * @param option Style option initialized from the model
+     * @param topicData Topic data
+     * @param column Column of the cell
+     */
+    void initTopicOption(QStyleOptionViewItem *option, TopicData *topicData, int column);
+
+    /*!
+     * @brief Build tooltip of topic tree cell from current state of topic
+     * @param topicData Topic data
+     * @param column Column of the cell
+     * @returns tooltip, empty if the cell has none
+     */
+    QString getTopicToolTip(TopicData *topicData, int column);
+
+    /*!
+     * @brief Collect topics matching filter pattern by walking topic hierarchy
+     * @param parent Topic matched by previous segments, null for top level
+     * @param level Index of pattern segment matched against children of parent
+     * @param matches Matching topics
+     */
+    void findPatternMatches(TopicData *parent, int level, QList<TopicData*> &matches);
+
+    /*!
+     * @brief Check single topic against active filter
+     * @param topicData Topic data
+     * @returns true if the topic matches
+     */
+    bool matchesTopicFilter(TopicData *topicData);
+
+    /*!
+     * @brief Make matching topic and all its ancestors visible
+     * @param topicData Matching topic
+     */
+    void addFilterMatch(TopicData *topicData);
+
+    /*!
+     * @brief Whether topic passes active filter
+     * @param topicData Topic data
+     * @returns true if there is no filter or topic matches it or is ancestor of match
+     */
+    bool isTopicVisible(TopicData *topicData);
+
+    /*!
+     * @brief Schedule repaint of tree row of topic for the next frame
+     * @param topicData Topic data
+     */
+    void markTopicDirty(TopicData *topicData);
+
+    /*!
+     * @brief Collect last messages of topics for snapshot export
+     * @param since Only topics changed after this generation are collected
+     * @returns work list
+     */
+    QVector<SnapshotEntry> buildSnapshotEntries(quint64 since = 0);
+
+    /*!
+     * @brief Read archive and all its base archives
+     * @param fileName Archive file name
+     * @param files Opened archive files, the newest first
+     * @param entries Entries of every archive in the same order as files
+     * @returns false if any of the archives could not be read
+     */
+    bool readArchiveChain(QString fileName, QList<QFile*> &files, QList<QVector<SnapshotEntry>> &entries);
+
+    /*!
+     * @brief Extract sequence number from payload and update sequence state of topic
+     * @param topicData topic data
+     * @param payload raw payload
+     */
+    void trackSequence(TopicData *topicData, QByteArray payload);
+
+    //! Reload aggregated sequence counters in footer
+    void reloadSequenceStatistics();
 
     //! Reload text for toggle subscribe button
     void reloadToggleButton();
@@ -195,6 +649,47 @@ private:
     //! Reload message history
     void reloadMessageList();
 
+    //! Append next page of spilled messages to message history list
+    void loadMessagePage();
+
+    /*!
+     * @brief Create item in message history list
+     * @param message Message
+     * @param row Row the item is inserted at, -1 to append
+     */
+    void addMessageItem(const TopicMessage &message, int row = -1);
+
+    /*!
+     * @brief Move message to disk, it is dropped if it could not be written
+     * @param topicData Topic data
+     * @param message Message removed from memory
+     */
+    void spillMessage(TopicData *topicData, const TopicMessage &message);
+
+    /*!
+     * @brief Release payload memory of message removed from memory
+     * @param topicData Topic data
+     * @param message Message
+     */
+    void releaseMessage(TopicData *topicData, const TopicMessage &message);
+
+    /*!
+     * @brief Add text message to search index and charge the index memory to its topic
+     * @param topicData Topic data
+     * @param id Message id
+     * @param topic Topic path
+     * @param text Text payload
+     * @param time Time the message was received (in milliseconds since epoch)
+     */
+    void indexMessage(TopicData *topicData, quint64 id, QString topic, QString text, qint64 time);
+
+    /*!
+     * @brief Remove message from search index and release the index memory of its topic
+     * @param topicData Topic data
+     * @param id Message id
+     */
+    void unindexMessage(TopicData *topicData, quint64 id);
+
     //! Clear dashboard
     void clearDashboard();
 
@@ -213,6 +708,33 @@ private:
     //! Simulator instance
     Simulator *simulator;
 
+    //! Background snapshot export
+    Snapshot *snapshot;
+
+    //! Progress of snapshot export
+    QProgressDialog *snapshotProgress;
+
+    //! Opened snapshot archive with its base archives, payloads of loaded topics point to their memory mapping
+    QList<QFile*> archives;
+
+    //! Generation counter, incremented whenever any topic is created or its payload changes
+    quint64 generation = 0;
+
+    //! Generation of the last successful snapshot by its target directory or archive file
+    QHash<QString, quint64> snapshotGenerations;
+
+    //! Target of running snapshot export
+    QString snapshotTarget;
+
+    //! Generation in which work list of running snapshot export was built
+    quint64 snapshotGeneration = 0;
+
+    //! Whether running snapshot export writes archive
+    bool snapshotArchive = false;
+
+    //! Last archive saved successfully, base of the next delta archive
+    QString lastArchive;
+
     //! Dashboard layout
     FlowLayout *flowLayout;
 
@@ -224,6 +746,117 @@ private:
 
     //! How many messages to keep in the history
     int history = 10;
+
+    //! How many of the newest messages of each topic to keep in memory
+    int memoryHistory = 10;
+
+    //! Storage of messages spilled from memory
+    HistoryStore historyStore;
+
+    //! Budget of payload memory with decoded images
+    PayloadCache payloadCache;
+
+    //! Messages in memory by id that may be spilled when the budget is exceeded, the newest message of each topic is not included
+    QMap<quint64, TopicData*> spillable;
+
+    //! Memory held by dashboard widgets by topic, charged to the topic while it is in the tree
+    QHash<QString, qint64> widgetMemory;
+
+    //! Id of the last stored message
+    quint64 lastMessageId = 0;
+
+    //! Thumbnails of image messages shown in topic tree and message history
+    ThumbnailCache *thumbnailCache;
+
+    //! Timer that refreshes memory columns while they are shown
+    QTimer memoryTimer;
+
+    //! Timer that writes memory report
+    QTimer memoryReportTimer;
+
+    //! Clock rates of topics are measured with
+    QElapsedTimer rateClock;
+
+    //! Timer that rolls up rates and refreshes rate columns while they are shown
+    QTimer rateTimer;
+
+    //! Topics that received messages since the last roll up of rates
+    QList<TopicData*> pendingRates;
+
+    //! Memory report file, empty if report is not written
+    QString memoryReport;
+
+    //! Index of text messages in history
+    SearchIndex searchIndex;
+
+    //! Maximum number of shown search results
+    static constexpr int maxSearchResults = 1000;
+
+    //! Top level topics in order of creation
+    QList<TopicData*> rootTopics;
+
+    //! Topics by lower case last segment of path
+    QHash<QString, QList<TopicData*>> topicsByName;
+
+    //! Active topic filter, empty when the whole tree is shown
+    QString topicFilter;
+
+    //! Segments of active filter when it is MQTT pattern, empty for substring filter
+    QStringList topicFilterPattern;
+
+    //! Matching topics and their ancestors
+    QSet<TopicData*> filterVisible;
+
+    //! How many matches are expanded to when filter changes
+    static constexpr int maxRevealedMatches = 200;
+
+    //! Topics whose tree rows are not repainted since they changed
+    QSet<TopicData*> dirtyTopics;
+
+    //! Timer that repaints tree rows of changed topics once per frame
+    QTimer flushTimer;
+
+    //! Topics deeper than this are not expanded automatically
+    static constexpr int autoExpandDepth = 4;
+
+    //! Topics with more children than this are not expanded automatically
+    static constexpr int autoExpandChildren = 32;
+
+    //! Whether a topic is being collapsed automatically, not by the user
+    bool autoCollapsing = false;
+
+    //! Sequence number this far below the highest one means the publisher restarted its counter
+    static constexpr quint64 sequenceRestartGap = 1000;
+
+    //! This many consecutive increasing numbers below the highest one mean the publisher restarted its counter
+    static constexpr int sequenceRestartRun = 3;
+
+    //! How many spilled messages are loaded at once when scrolling message history
+    static constexpr int messagePageSize = 100;
+
+    //! How many published messages can wait for acknowledgement at once
+    int inflight = 16;
+
+    //! QoS of published messages
+    int publishQos = 1;
+
+    //! Delivery counters shown in footer
+    QLabel *labelPublishStatistics;
+
+    //! Topic data by topic path
+    QHash<QString, TopicData*> topics;
+
+    //! Path of sequence number in JSON payloads, whole payload for "$"
+    JsonPath sequencePath;
+
+    //! Whether sequence numbers are tracked
+    bool sequenceTracking = false;
+
+    //! Aggregated sequence counters of all topics
+    SequenceState sequenceTotals;
+
+    //! Aggregated sequence counters shown in footer
+    QLabel *labelSequenceStatistics;
 };
 
 #endif
\ No newline at end of file
@@ -80,6 +80,8 @@ FlowLayout::~FlowLayout()
 void FlowLayout::addItem(QLayoutItem *item)
 {
     itemList.append(item);
+    m_geometries.append(QRect());
+    m_cacheValid = false;
 }
 //! [3]
 
@@ -116,10 +118,19 @@ QLayoutItem *FlowLayout::itemAt(int index) const
 
 QLayoutItem *FlowLayout::takeAt(int index)
 {
-    if (index >= 0 && index < itemList.size())
+    if (index >= 0 && index < itemList.size()) {
+        m_geometries.remove(index);
+        m_cacheValid = false;
         return itemList.takeAt(index);
-    else
+    } else {
         return 0;
+    }
+}
+
+void FlowLayout::invalidate()
+{
+    m_cacheValid = false;
+    QLayout::invalidate();
 }
 //! [5]
 
@@ -138,8 +149,12 @@ bool FlowLayout::hasHeightForWidth() const
 
 int FlowLayout::heightForWidth(int width) const
 {
-    int height = doLayout(QRect(0, 0, width, 0), true);
-    return height;
+    updateCache();
+    if (width != m_hfwWidth) {
+        m_hfwWidth = width;
+        m_hfwHeight = doLayout(QRect(0, 0, width, 0), true);
+    }
+    return m_hfwHeight;
 }
 //! [7]
 
@@ -148,6 +163,7 @@ void FlowLayout::setGeometry(const QRect &rect)
 {
     QLayout::setGeometry(rect);
     doLayout(rect, false);
+    emit itemsPlaced();
 }
 
 QSize FlowLayout::sizeHint() const
@@ -179,36 +195,59 @@ int FlowLayout::doLayout(const QRect &rect, bool testOnly) const
 //! [9]
 
 //! [10]
-    QLayoutItem *item;
-    foreach (item, itemList) {
-        QWidget *wid = item->widget();
-        int spaceX = horizontalSpacing();
-        if (spaceX == -1)
-            spaceX = wid->style()->layoutSpacing(
-                QSizePolicy::PushButton, QSizePolicy::PushButton, Qt::Horizontal);
-        int spaceY = verticalSpacing();
-        if (spaceY == -1)
-            spaceY = wid->style()->layoutSpacing(
-                QSizePolicy::PushButton, QSizePolicy::PushButton, Qt::Vertical);
+    updateCache();
+    for (int i = 0; i < itemList.size(); ++i) {
+        const QSize &hint = m_hints.at(i);
 //! [10]
 //! [11]
-        int nextX = x + item->sizeHint().width() + spaceX;
-        if (nextX - spaceX > effectiveRect.right() && lineHeight > 0) {
+        int nextX = x + hint.width() + m_spaceX;
+        if (nextX - m_spaceX > effectiveRect.right() && lineHeight > 0) {
             x = effectiveRect.x();
-            y = y + lineHeight + spaceY;
-            nextX = x + item->sizeHint().width() + spaceX;
+            y = y + lineHeight + m_spaceY;
+            nextX = x + hint.width() + m_spaceX;
             lineHeight = 0;
         }
 
-        if (!testOnly)
-            item->setGeometry(QRect(QPoint(x, y), item->sizeHint()));
+        if (!testOnly) {
+            QRect geometry(QPoint(x, y), hint);
+            if (geometry != m_geometries.at(i)) {
+                itemList.at(i)->setGeometry(geometry);
+                m_geometries[i] = geometry;
+            }
+        }
 
         x = nextX;
-        lineHeight = qMax(lineHeight, item->sizeHint().height());
+        lineHeight = qMax(lineHeight, hint.height());
     }
     return y + lineHeight - rect.y() + bottom;
 }
 //! [11]
+
+void FlowLayout::updateCache() const
+{
+    if (m_cacheValid)
+        return;
+
+    m_hints.resize(itemList.size());
+    for (int i = 0; i < itemList.size(); ++i)
+        m_hints[i] = itemList.at(i)->sizeHint();
+
+    // All items share the style, so the spacing is taken from the first one
+    QWidget *wid = itemList.isEmpty() ? 0 : itemList.first()->widget();
+
+    m_spaceX = horizontalSpacing();
+    if (m_spaceX == -1 && wid)
+        m_spaceX = wid->style()->layoutSpacing(
+            QSizePolicy::PushButton, QSizePolicy::PushButton, Qt::Horizontal);
+    m_spaceY = verticalSpacing();
+    if (m_spaceY == -1 && wid)
+        m_spaceY = wid->style()->layoutSpacing(
+            QSizePolicy::PushButton, QSizePolicy::PushButton, Qt::Vertical);
+
+    m_hfwWidth = -1;
+    m_cacheValid = true;
+}
+
 //! [12]
 int FlowLayout::smartSpacing(QStyle::PixelMetric pm) const
 {
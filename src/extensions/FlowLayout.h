@@ -55,10 +55,14 @@
 
 #include <QLayout>
 #include <QRect>
+#include <QSize>
 #include <QStyle>
+#include <QVector>
 //! [0]
 class FlowLayout : public QLayout
 {
+    Q_OBJECT
+
 public:
     explicit FlowLayout(QWidget *parent, int margin = -1, int hSpacing = -1, int vSpacing = -1);
     explicit FlowLayout(int margin = -1, int hSpacing = -1, int vSpacing = -1);
@@ -76,14 +80,33 @@ public:
     void setGeometry(const QRect &rect) override;
     QSize sizeHint() const override;
     QLayoutItem *takeAt(int index) override;
+    void invalidate() override;
+
+signals:
+    //! Emitted after items were placed, e.g. to find items outside of the visible area
+    void itemsPlaced();
 
 private:
     int doLayout(const QRect &rect, bool testOnly) const;
     int smartSpacing(QStyle::PixelMetric pm) const;
+    void updateCache() const;
 
     QList<QLayoutItem *> itemList;
     int m_hSpace;
     int m_vSpace;
+
+    // Size hints and spacing are cached until the layout is invalidated
+    mutable QVector<QSize> m_hints;
+    mutable int m_spaceX = -1;
+    mutable int m_spaceY = -1;
+    mutable bool m_cacheValid = false;
+
+    // Last result of heightForWidth
+    mutable int m_hfwWidth = -1;
+    mutable int m_hfwHeight = -1;
+
+    // Geometry last set to each item, only items whose geometry changes are moved
+    mutable QVector<QRect> m_geometries;
 };
 //! [0]
 
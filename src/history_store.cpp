@@ -0,0 +1,114 @@
+/*!
+ * @file history_store.cpp
+ * @author Michal Šlesár (xslesa01)
+ * @author Erik Belko (xbelko02)
+ * @brief Implementation of HistoryStore
+ */
+
+#include "history_store.h"
+
+#include <QDir>
+#include <QtGlobal>
+
+HistoryStore::HistoryStore() : directory(QDir::tempPath() + "/mqtt-explorer-history-XXXXXX") {}
+
+bool HistoryStore::append(const QByteArray &payload, HistoryRef &ref)
+{
+    if(!directory.isValid())
+        return false;
+
+    // Seal full segment and start a new one
+    if(active != Q_NULLPTR && active->size + payload.size() > segmentSize)
+    {
+        if(active->live == 0)
+            removeSegment(activeId);
+
+        active = Q_NULLPTR;
+    }
+
+    if(active == Q_NULLPTR)
+    {
+        activeId++;
+
+        auto segment = new HistorySegment();
+        segment->file.setFileName(directory.filePath(QString("segment-%1").arg(activeId)));
+
+        if(!segment->file.open(QIODevice::ReadWrite | QIODevice::Truncate))
+        {
+            delete segment;
+            return false;
+        }
+
+        segments.insert(activeId, segment);
+        active = segment;
+    }
+
+    // Seeking flushes the write buffer, so reads always see appended payloads
+    if(!active->file.seek(active->size) || active->file.write(payload) != payload.size())
+    {
+        qWarning("Could not write history segment %s", qPrintable(active->file.fileName()));
+        return false;
+    }
+
+    ref.segment = activeId;
+    ref.offset = active->size;
+    ref.length = payload.size();
+
+    active->size += payload.size();
+    active->live++;
+
+    return true;
+}
+
+QByteArray HistoryStore::read(const HistoryRef &ref)
+{
+    auto segment = segments.value(ref.segment, Q_NULLPTR);
+
+    if(segment == Q_NULLPTR || !segment->file.seek(ref.offset))
+        return QByteArray();
+
+    auto payload = segment->file.read(ref.length);
+
+    if(payload.size() != (int) ref.length)
+        return QByteArray();
+
+    return payload;
+}
+
+void HistoryStore::release(const HistoryRef &ref)
+{
+    auto segment = segments.value(ref.segment, Q_NULLPTR);
+
+    if(segment == Q_NULLPTR || segment->live == 0)
+        return;
+
+    segment->live--;
+
+    // Active segment is kept, new payloads are still appended to it
+    if(segment->live == 0 && segment != active)
+        removeSegment(ref.segment);
+}
+
+void HistoryStore::clear()
+{
+    for(auto id : segments.keys())
+        removeSegment(id);
+
+    active = Q_NULLPTR;
+}
+
+void HistoryStore::removeSegment(quint32 id)
+{
+    auto segment = segments.take(id);
+
+    if(segment == Q_NULLPTR)
+        return;
+
+    segment->file.remove();
+    delete segment;
+}
+
+HistoryStore::~HistoryStore()
+{
+    clear();
+}
@@ -0,0 +1,120 @@
+/*!
+ * @file history_store.h
+ * @author Michal Šlesár (xslesa01)
+ * @author Erik Belko (xbelko02)
+ * @brief Disk storage of older topic history
+ */
+
+#ifndef E_HISTORY_STORE_H
+#define E_HISTORY_STORE_H
+
+#include <QFile>
+#include <QHash>
+#include <QString>
+#include <QByteArray>
+#include <QTemporaryDir>
+
+//! Reference to message spilled to history segment
+class HistoryRef
+{
+public:
+    //! Id the message had in memory
+    quint64 id = 0;
+
+    //! Segment the payload is stored in
+    quint32 segment = 0;
+
+    //! Length of the payload
+    quint32 length = 0;
+
+    //! Offset of the payload in segment
+    quint64 offset = 0;
+
+    //! Time the message was received (in milliseconds since epoch)
+    qint64 time = 0;
+
+    //! Whether the message was sent from us
+    bool local = false;
+
+    //! Whether the payload is an image
+    bool isImage = false;
+};
+
+//! One append-only segment file
+class HistorySegment
+{
+public:
+    //! Segment file, opened for both appending and reading
+    QFile file;
+
+    //! Number of bytes written to segment
+    quint64 size = 0;
+
+    //! Number of references that still point to segment
+    quint64 live = 0;
+};
+
+/*!
+ * @brief Append-only storage of message payloads for the current session
+ *
+ * Payloads are appended to segment files in temporary directory, only HistoryRef stays in memory.
+ * Segment that is full is sealed, once nothing references it the file is removed.
+ * All segments are removed when the store is destroyed.
+ */
+class HistoryStore
+{
+public:
+    //! Constructor
+    HistoryStore();
+
+    //! Destructor, removes all segments
+    ~HistoryStore();
+
+    /*!
+     * @brief Append payload to the active segment
+     * @param payload Raw payload
+     * @param ref Reference to the stored payload, metadata must be filled in by the caller
+     * @returns false if the payload could not be written
+     */
+    bool append(const QByteArray &payload, HistoryRef &ref);
+
+    /*!
+     * @brief Read payload back from its segment
+     * @param ref Reference returned by append
+     * @returns payload, null byte array when reading failed
+     */
+    QByteArray read(const HistoryRef &ref);
+
+    /*!
+     * @brief Drop reference, segment is removed when nothing references it
+     * @param ref Reference returned by append
+     */
+    void release(const HistoryRef &ref);
+
+    //! Remove all segments
+    void clear();
+
+    //! Size of segment after which a new segment is started
+    static constexpr quint64 segmentSize = 64 * 1024 * 1024;
+
+private:
+    /*!
+     * @brief Remove segment file
+     * @param id Segment id
+     */
+    void removeSegment(quint32 id);
+
+    //! Directory with segments of this session
+    QTemporaryDir directory;
+
+    //! Open segments by id
+    QHash<quint32, HistorySegment*> segments;
+
+    //! Segment new payloads are appended to
+    HistorySegment *active = Q_NULLPTR;
+
+    //! Id of the active segment
+    quint32 activeId = 0;
+};
+
+#endif
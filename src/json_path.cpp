@@ -0,0 +1,348 @@
+/*!
+ * @file json_path.cpp
+ * @author Michal Šlesár (xslesa01)
+ * @author Erik Belko (xbelko02)
+ * @brief Implementation of JsonPath
+ */
+
+#include "json_path.h"
+
+#include <cstring>
+
+#include <QChar>
+
+bool JsonPath::compile(QString path)
+{
+    segments.clear();
+    path = path.trimmed();
+
+    if(path.startsWith("$"))
+        path = path.mid(1);
+
+    // Names follow a dot (the first one may omit it), brackets hold only array indexes
+    for(auto pos = 0; pos < path.size();)
+    {
+        JsonPathSegment segment;
+
+        if(path[pos] == '[')
+        {
+            auto end = path.indexOf(']', pos);
+            auto part = end < 0 ? QString() : path.mid(pos + 1, end - pos - 1);
+            segment.index = parseIndex(part);
+
+            // Quoted keys like ["key"] are not supported
+            if(segment.index < 0)
+            {
+                segments.clear();
+                return false;
+            }
+
+            segment.key = part.toUtf8();
+            pos = end + 1;
+        }
+        else
+        {
+            if(path[pos] == '.')
+                pos++;
+            else if(pos > 0)
+            {
+                segments.clear();
+                return false;
+            }
+
+            auto end = pos;
+            while(end < path.size() && path[end] != '.' && path[end] != '[')
+                end++;
+
+            auto part = path.mid(pos, end - pos);
+            if(part.isEmpty() || part.contains(']'))
+            {
+                segments.clear();
+                return false;
+            }
+
+            segment.key = part.toUtf8();
+            segment.index = parseIndex(part);
+            pos = end;
+        }
+
+        segments.append(segment);
+    }
+
+    return true;
+}
+
+bool JsonPath::isWholePayload() const
+{
+    return segments.isEmpty();
+}
+
+bool JsonPath::find(const QByteArray &payload, QByteArray &value) const
+{
+    if(segments.isEmpty())
+    {
+        value = payload;
+        return true;
+    }
+
+    auto data = payload.constData();
+    auto size = payload.size();
+    auto pos = 0;
+
+    for(auto &segment : segments)
+    {
+        pos = skipWhitespace(data, pos, size);
+        if(pos >= size)
+            return false;
+
+        if(data[pos] == '{')
+        {
+            pos++;
+
+            // Fields before the target are skipped without decoding
+            while(true)
+            {
+                pos = skipWhitespace(data, pos, size);
+                if(pos >= size || data[pos] != '"')
+                    return false;
+
+                auto keyEnd = skipString(data, pos, size);
+                if(keyEnd < 0)
+                    return false;
+
+                auto key = data + pos + 1;
+                auto keySize = keyEnd - pos - 2;
+                auto matches = std::memchr(key, '\\', keySize) != Q_NULLPTR ? 
+                    unescape(key, keySize) == segment.key :
+                    keySize == segment.key.size() && std::memcmp(key, segment.key.constData(), keySize) == 0;
+
+                pos = skipWhitespace(data, keyEnd, size);
+                if(pos >= size || data[pos] != ':')
+                    return false;
+
+                pos = skipWhitespace(data, pos + 1, size);
+                if(matches)
+                    break;
+
+                pos = skipValue(data, pos, size);
+                if(pos < 0)
+                    return false;
+
+                pos = skipWhitespace(data, pos, size);
+                if(pos >= size || data[pos] != ',')
+                    return false;
+
+                pos++;
+            }
+        }
+        else if(data[pos] == '[' && segment.index >= 0)
+        {
+            pos++;
+
+            for(auto i = 0; ; i++)
+            {
+                pos = skipWhitespace(data, pos, size);
+                if(pos >= size || data[pos] == ']')
+                    return false;
+
+                if(i == segment.index)
+                    break;
+
+                pos = skipValue(data, pos, size);
+                if(pos < 0)
+                    return false;
+
+                pos = skipWhitespace(data, pos, size);
+                if(pos >= size || data[pos] != ',')
+                    return false;
+
+                pos++;
+            }
+        }
+        else
+            return false;
+    }
+
+    // Target is reached, the rest of payload is not read
+    pos = skipWhitespace(data, pos, size);
+    if(pos >= size)
+        return false;
+
+    auto end = skipValue(data, pos, size);
+    if(end < 0)
+        return false;
+
+    if(data[pos] == '"')
+        value = unescape(data + pos + 1, end - pos - 2);
+    else
+        value = QByteArray(data + pos, end - pos);
+
+    return true;
+}
+
+int JsonPath::skipWhitespace(const char *data, int pos, int size)
+{
+    while(pos < size && (data[pos] == ' ' || data[pos] == '\t' || data[pos] == '\n' || data[pos] == '\r'))
+        pos++;
+
+    return pos;
+}
+
+int JsonPath::skipString(const char *data, int pos, int size)
+{
+    for(pos++; pos < size; pos++)
+    {
+        if(data[pos] == '\\')
+            pos++;
+        else if(data[pos] == '"')
+            return pos + 1;
+    }
+
+    return -1;
+}
+
+int JsonPath::skipValue(const char *data, int pos, int size)
+{
+    if(pos >= size)
+        return -1;
+
+    if(data[pos] == '"')
+        return skipString(data, pos, size);
+
+    // Nested values are skipped by counting brackets, strings may contain brackets
+    if(data[pos] == '{' || data[pos] == '[')
+    {
+        auto depth = 0;
+
+        while(pos < size)
+        {
+            auto c = data[pos];
+
+            if(c == '"')
+            {
+                pos = skipString(data, pos, size);
+                if(pos < 0)
+                    return -1;
+
+                continue;
+            }
+
+            if(c == '{' || c == '[')
+                depth++;
+            else if((c == '}' || c == ']') && --depth == 0)
+                return pos + 1;
+
+            pos++;
+        }
+
+        return -1;
+    }
+
+    // Number, true, false or null
+    auto start = pos;
+    while(pos < size && !std::strchr(",}] \t\r\n", data[pos]))
+        pos++;
+
+    return pos > start ? pos : -1;
+}
+
+QByteArray JsonPath::unescape(const char *data, int size)
+{
+    if(std::memchr(data, '\\', size) == Q_NULLPTR)
+        return QByteArray(data, size);
+
+    QByteArray result;
+    result.reserve(size);
+
+    for(auto i = 0; i < size; i++)
+    {
+        if(data[i] != '\\' || i + 1 >= size)
+        {
+            result.append(data[i]);
+            continue;
+        }
+
+        auto c = data[++i];
+        switch(c)
+        {
+            case 'b': result.append('\b'); break;
+            case 'f': result.append('\f'); break;
+            case 'n': result.append('\n'); break;
+            case 'r': result.append('\r'); break;
+            case 't': result.append('\t'); break;
+            case 'u':
+            {
+                // Escape without four hex digits is copied as it is
+                auto code = parseHex(data, i + 1, size);
+                if(code < 0)
+                {
+                    result.append("\\u");
+                    break;
+                }
+
+                i += 4;
+
+                // Surrogate pair is two escapes, lone surrogate is replaced by U+FFFD
+                auto character = (uint) code;
+                if(QChar::isHighSurrogate(character))
+                {
+                    auto low = i + 2 < size && data[i + 1] == '\\' && data[i + 2] == 'u' ? parseHex(data, i + 3, size) : -1;
+                    if(low >= 0 && QChar::isLowSurrogate((uint) low))
+                    {
+                        character = QChar::surrogateToUcs4((ushort) code, (ushort) low);
+                        i += 6;
+                    }
+                    else
+                        character = QChar::ReplacementCharacter;
+                }
+                else if(QChar::isLowSurrogate(character))
+                    character = QChar::ReplacementCharacter;
+
+                result.append(QString::fromUcs4(&character, 1).toUtf8());
+                break;
+            }
+            default: result.append(c); break;
+        }
+    }
+
+    return result;
+}
+
+int JsonPath::parseHex(const char *data, int pos, int size)
+{
+    if(pos + 4 > size)
+        return -1;
+
+    auto code = 0;
+    for(auto i = pos; i < pos + 4; i++)
+    {
+        auto c = data[i];
+        code *= 16;
+
+        if(c >= '0' && c <= '9')
+            code += c - '0';
+        else if(c >= 'a' && c <= 'f')
+            code += c - 'a' + 10;
+        else if(c >= 'A' && c <= 'F')
+            code += c - 'A' + 10;
+        else
+            return -1;
+    }
+
+    return code;
+}
+
+int JsonPath::parseIndex(const QString &part)
+{
+    if(part.isEmpty())
+        return -1;
+
+    for(auto c : part)
+        if(c < '0' || c > '9')
+            return -1;
+
+    bool isIndex;
+    auto index = part.toInt(&isIndex);
+
+    return isIndex ? index : -1;
+}
@@ -0,0 +1,113 @@
+/*!
+ * @file json_path.h
+ * @author Michal Šlesár (xslesa01)
+ * @author Erik Belko (xbelko02)
+ * @brief Extraction of single field from JSON payload
+ */
+
+#ifndef E_JSON_PATH_H
+#define E_JSON_PATH_H
+
+#include <QString>
+#include <QVector>
+#include <QByteArray>
+
+//! One step of JsonPath
+class JsonPathSegment
+{
+public:
+    //! Name of object field
+    QByteArray key;
+
+    //! Index into array, -1 if the segment is not a number
+    int index = -1;
+};
+
+/*!
+ * @brief Compiled path to field of JSON payload
+ *
+ * Path is written as "$.env.temp", "env.temp", "$.values[0]" or "values.0", "$" or empty path is the whole payload.
+ * Numeric segment indexes arrays and also matches object field of the same name. Brackets hold only array indexes,
+ * quoted keys like "$[\"key\"]" are rejected.
+ *
+ * Payload is not parsed into QJsonDocument. The scanner walks bytes, skips values of other fields
+ * without decoding them and stops once it reaches the target field.
+ */
+class JsonPath
+{
+public:
+    /*!
+     * @brief Compile path
+     * @param path Path
+     * @returns false if the path is malformed
+     */
+    bool compile(QString path);
+
+    //! Whether the path points to the whole payload
+    bool isWholePayload() const;
+
+    /*!
+     * @brief Find value of field
+     * @param payload JSON payload
+     * @param value Contents of string field, text of any other field, whole payload for empty path
+     * @returns false if the field does not exist or payload is malformed before it
+     */
+    bool find(const QByteArray &payload, QByteArray &value) const;
+
+private:
+    /*!
+     * @brief Skip whitespace
+     * @param data Payload
+     * @param pos Position
+     * @param size Size of payload
+     * @returns position of the next other character
+     */
+    static int skipWhitespace(const char *data, int pos, int size);
+
+    /*!
+     * @brief Skip string
+     * @param data Payload
+     * @param pos Position of opening quote
+     * @param size Size of payload
+     * @returns position after closing quote, -1 if the string is not terminated
+     */
+    static int skipString(const char *data, int pos, int size);
+
+    /*!
+     * @brief Skip any value including nested objects and arrays
+     * @param data Payload
+     * @param pos Position of the first character of value
+     * @param size Size of payload
+     * @returns position after value, -1 if the value is not terminated
+     */
+    static int skipValue(const char *data, int pos, int size);
+
+    /*!
+     * @brief Decode escape sequences of string
+     * @param data Contents of string without quotes
+     * @param size Size of contents
+     * @returns UTF-8 string
+     */
+    static QByteArray unescape(const char *data, int size);
+
+    /*!
+     * @brief Decode four hex digits of unicode escape
+     * @param data Payload
+     * @param pos Position of the first digit
+     * @param size Size of payload
+     * @returns code unit, -1 if the digits are missing or are not hex
+     */
+    static int parseHex(const char *data, int pos, int size);
+
+    /*!
+     * @brief Parse array index of path segment
+     * @param part Segment of path
+     * @returns index, -1 if the segment is not a plain non-negative number
+     */
+    static int parseIndex(const QString &part);
+
+    //! Segments of path, empty for the whole payload
+    QVector<JsonPathSegment> segments;
+};
+
+#endif
@@ -5,20 +5,63 @@
  * @brief Main file of application
  */
 
+#include <csignal>
+
+#include <QFile>
+#include <QTimer>
 #include <QApplication>
 #include <QCommandLineParser>
 
 #include "explorer.h"
+#include "json_path.h"
+
+//! Set when SIGINT or SIGTERM is received
+static volatile std::sig_atomic_t quitRequested = 0;
+
+/*!
+ * @brief Remember termination request, the application is quit from event loop
+ * @param signal Received signal
+ */
+static void onTerminationSignal([[maybe_unused]] int signal)
+{
+    quitRequested = 1;
+}
 
 int main(int argc, char **argv)
 {
+    // Headless run may have no display, window is then created on the offscreen platform,
+    // platform is chosen when the application is created, so argv is checked before the parser runs
+    for(auto i = 1; i < argc; i++)
+        if(qstrcmp(argv[i], "--headless") == 0 && qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+            qputenv("QT_QPA_PLATFORM", "offscreen");
+
     QApplication app(argc, argv);
     QCoreApplication::setApplicationName("mqtt-explorer");
     QCoreApplication::setApplicationVersion("1.0");
 
     QCommandLineParser parser;
     QCommandLineOption historyOption(QStringList() << "h" << "history", "How many messages to keep in the history (Default: 10)", "history");
+    QCommandLineOption memoryOption(QStringList() << "m" << "memory-history", "How many of the newest messages of each topic to keep in memory, older messages of the history are moved to disk (Default: 10)", "count");
+    QCommandLineOption budgetOption(QStringList() << "b" << "memory-budget", "How many MiB payloads and decoded images of all topics can use, decoded images are evicted first (Default: 256)", "MiB");
+    QCommandLineOption inflightOption(QStringList() << "w" << "inflight", "How many published messages can wait for acknowledgement at once (Default: 16)", "inflight");
+    QCommandLineOption qosOption(QStringList() << "q" << "qos", "QoS of published messages, with QoS 0 messages are not acknowledged by the server (Default: 1)", "qos");
+    QCommandLineOption sequenceOption(QStringList() << "s" << "sequence-field", "Track sequence numbers in payloads, JSON path of the field or $ for the whole payload (Default: off)", "path");
+    QCommandLineOption serverOption(QStringList() << "server", "Connect to server on start", "address");
+    QCommandLineOption subscribeOption(QStringList() << "subscribe", "Subscribe topic on start, can be used more times", "topic");
+    QCommandLineOption subscribeFileOption(QStringList() << "subscribe-file", "Subscribe all topics of subscription list on start, one topic per line", "file");
+    QCommandLineOption reportOption(QStringList() << "memory-report", "Write memory usage of topics to CSV file every 10 seconds and on exit", "file");
+    QCommandLineOption headlessOption(QStringList() << "headless", "Do not show the window, requires --server and --memory-report, exits with status 1 if the server can not be reached");
     parser.addOption(historyOption);
+    parser.addOption(memoryOption);
+    parser.addOption(budgetOption);
+    parser.addOption(inflightOption);
+    parser.addOption(qosOption);
+    parser.addOption(sequenceOption);
+    parser.addOption(serverOption);
+    parser.addOption(subscribeOption);
+    parser.addOption(subscribeFileOption);
+    parser.addOption(reportOption);
+    parser.addOption(headlessOption);
     parser.process(app);
 
     bool isInteger;
@@ -27,8 +70,89 @@ int main(int argc, char **argv)
     if(parser.isSet(historyOption) && (!isInteger || history < 1))
         qFatal("History option must contain numeric value >= 1");
 
-    Explorer explorer(parser.isSet(historyOption) ? history : 10);
-    explorer.show();
+    int memoryHistory = parser.value(memoryOption).toInt(&isInteger);
+
+    if(parser.isSet(memoryOption) && (!isInteger || memoryHistory < 1))
+        qFatal("Memory history option must contain numeric value >= 1");
+
+    int budget = parser.value(budgetOption).toInt(&isInteger);
+
+    if(parser.isSet(budgetOption) && (!isInteger || budget < 1))
+        qFatal("Memory budget option must contain numeric value >= 1");
+
+    int inflight = parser.value(inflightOption).toInt(&isInteger);
+
+    if(parser.isSet(inflightOption) && (!isInteger || inflight < 1))
+        qFatal("Inflight option must contain numeric value >= 1");
+
+    int qos = parser.value(qosOption).toInt(&isInteger);
+
+    if(parser.isSet(qosOption) && (!isInteger || qos < 0 || qos > 2))
+        qFatal("QoS option must contain value 0, 1 or 2");
+
+    JsonPath sequencePath;
+
+    if(parser.isSet(sequenceOption) && !sequencePath.compile(parser.value(sequenceOption)))
+        qFatal("Sequence field option must contain valid JSON path");
+
+    // Topics are subscribed only on the connection opened on start
+    if((parser.isSet(subscribeOption) || parser.isSet(subscribeFileOption)) && !parser.isSet(serverOption))
+        qFatal("Subscribe options require --server option");
+
+    if(parser.isSet(headlessOption) && !parser.isSet(serverOption))
+        qFatal("Headless mode requires --server option");
+
+    if(parser.isSet(headlessOption) && !parser.isSet(reportOption))
+        qFatal("Headless mode requires --memory-report option");
+
+    Explorer explorer(parser.isSet(historyOption) ? history : 10, parser.isSet(memoryOption) ? memoryHistory : 10, 
+        (parser.isSet(budgetOption) ? budget : 256) * 1024LL * 1024LL, parser.isSet(inflightOption) ? inflight : 16, 
+        parser.isSet(qosOption) ? qos : 1, parser.value(sequenceOption));
+
+    if(parser.isSet(reportOption))
+        explorer.setMemoryReport(parser.value(reportOption));
+
+    // Without window nobody would see that the server is unreachable, exit is queued as the event loop is not running yet
+    if(parser.isSet(headlessOption))
+    {
+        QObject::connect(&explorer, &Explorer::connectionFailed, &app, []() {
+            qWarning("Could not connect to server");
+            QCoreApplication::exit(1);
+        }, Qt::QueuedConnection);
+    }
+
+    if(parser.isSet(serverOption))
+    {
+        explorer.connectTo(parser.value(serverOption));
+
+        // Client subscribes once the connection is established
+        for(auto topic : parser.values(subscribeOption))
+            explorer.subscribeTopic(topic);
+
+        if(parser.isSet(subscribeFileOption))
+        {
+            QFile file(parser.value(subscribeFileOption));
+
+            if(!file.open(QIODevice::ReadOnly))
+                qFatal("Subscription list could not be read");
+
+            explorer.importSubscriptions(file.readAll());
+        }
+    }
+
+    if(!parser.isSet(headlessOption))
+        explorer.show();
+
+    // Terminating signal quits the event loop, so the explorer is destroyed and writes the final memory report
+    std::signal(SIGINT, onTerminationSignal);
+    std::signal(SIGTERM, onTerminationSignal);
+
+    QTimer signalTimer;
+    QObject::connect(&signalTimer, &QTimer::timeout, &app, []() {
+        if(quitRequested)
+            QCoreApplication::quit();
+    });
+    signalTimer.start(200);
 
     return app.exec();
 }
\ No newline at end of file
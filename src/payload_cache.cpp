@@ -0,0 +1,131 @@
+/*!
+ * @file payload_cache.cpp
+ * @author Michal Šlesár (xslesa01)
+ * @author Erik Belko (xbelko02)
+ * @brief Implementation of PayloadCache
+ */
+
+#include "payload_cache.h"
+
+void PayloadAccount::charge(qint64 raw, qint64 decoded)
+{
+    this->raw += raw;
+    this->decoded += decoded;
+
+    for(auto account = this; account != Q_NULLPTR; account = account->parent)
+    {
+        account->subtreeRaw += raw;
+        account->subtreeDecoded += decoded;
+    }
+}
+
+void PayloadAccount::count(qint64 messages, qint64 spilled)
+{
+    this->messages += messages;
+    this->spilled += spilled;
+
+    for(auto account = this; account != Q_NULLPTR; account = account->parent)
+    {
+        account->subtreeMessages += messages;
+        account->subtreeSpilled += spilled;
+    }
+}
+
+void PayloadCache::setBudget(qint64 bytes)
+{
+    budget = bytes;
+    evict();
+}
+
+qint64 PayloadCache::getBudget()
+{
+    return budget;
+}
+
+qint64 PayloadCache::getTotal()
+{
+    return raw + decoded;
+}
+
+bool PayloadCache::isOverBudget()
+{
+    return raw > budget;
+}
+
+void PayloadCache::addRaw(PayloadAccount *account, qint64 bytes)
+{
+    account->charge(bytes, 0);
+    raw += bytes;
+
+    evict();
+}
+
+void PayloadCache::removeRaw(PayloadAccount *account, qint64 bytes)
+{
+    account->charge(-bytes, 0);
+    raw -= bytes;
+}
+
+void PayloadCache::insert(quint64 id, QPixmap pixmap, PayloadAccount *account)
+{
+    if(pixmap.isNull() || entries.contains(id))
+        return;
+
+    // Pixmap keeps its pixels uncompressed
+    auto cost = (qint64) pixmap.width() * pixmap.height() * pixmap.depth() / 8;
+
+    if(cost > budget)
+        return;
+
+    PayloadCacheEntry entry;
+    entry.pixmap = pixmap;
+    entry.account = account;
+    entry.cost = cost;
+    entry.position = order.insert(order.end(), id);
+    entries.insert(id, entry);
+
+    account->charge(0, cost);
+    decoded += cost;
+
+    evict();
+}
+
+QPixmap PayloadCache::find(quint64 id)
+{
+    auto it = entries.find(id);
+
+    if(it == entries.end())
+        return QPixmap();
+
+    // Move to the end of LRU order
+    order.splice(order.end(), order, it->position);
+    return it->pixmap;
+}
+
+void PayloadCache::remove(quint64 id)
+{
+    auto it = entries.find(id);
+
+    if(it == entries.end())
+        return;
+
+    it->account->charge(0, -it->cost);
+    decoded -= it->cost;
+
+    order.erase(it->position);
+    entries.erase(it);
+}
+
+void PayloadCache::clear()
+{
+    entries.clear();
+    order.clear();
+    decoded = 0;
+    raw = 0;
+}
+
+void PayloadCache::evict()
+{
+    while(raw + decoded > budget && !order.empty())
+        remove(order.front());
+}
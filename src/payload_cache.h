@@ -0,0 +1,166 @@
+/*!
+ * @file payload_cache.h
+ * @author Michal Šlesár (xslesa01)
+ * @author Erik Belko (xbelko02)
+ * @brief Memory budget of message payloads
+ */
+
+#ifndef E_PAYLOAD_CACHE_H
+#define E_PAYLOAD_CACHE_H
+
+#include <list>
+
+#include <QHash>
+#include <QPixmap>
+
+/*!
+ * @brief Payload memory used by one topic and its subtree
+ *
+ * Changes are rolled up to accounts of all ancestors right away, so subtree totals are always current.
+ */
+class PayloadAccount
+{
+public:
+    /*!
+     * @brief Charge or release memory
+     * @param raw Change of raw bytes
+     * @param decoded Change of decoded bytes
+     */
+    void charge(qint64 raw, qint64 decoded);
+
+    /*!
+     * @brief Count added or removed history entries
+     * @param messages Change of entries in memory
+     * @param spilled Change of entries on disk
+     */
+    void count(qint64 messages, qint64 spilled);
+
+    //! Bytes of raw payloads kept in memory
+    qint64 raw = 0;
+
+    //! Bytes of decoded images kept in cache
+    qint64 decoded = 0;
+
+    //! History entries in memory
+    qint64 messages = 0;
+
+    //! History entries spilled to disk
+    qint64 spilled = 0;
+
+    //! Raw bytes of the topic and all its descendants
+    qint64 subtreeRaw = 0;
+
+    //! Decoded bytes of the topic and all its descendants
+    qint64 subtreeDecoded = 0;
+
+    //! History entries in memory of the topic and all its descendants
+    qint64 subtreeMessages = 0;
+
+    //! History entries on disk of the topic and all its descendants
+    qint64 subtreeSpilled = 0;
+
+    //! Account of parent topic, null for top level topics
+    PayloadAccount *parent = Q_NULLPTR;
+};
+
+//! Decoded image held by PayloadCache
+class PayloadCacheEntry
+{
+public:
+    //! Decoded image
+    QPixmap pixmap;
+
+    //! Account the image is charged to
+    PayloadAccount *account;
+
+    //! Size of decoded image in bytes
+    qint64 cost;
+
+    //! Position in LRU order
+    std::list<quint64>::iterator position;
+};
+
+/*!
+ * @brief Process-wide budget of payload memory
+ *
+ * Raw payloads and decoded images are charged to accounts of their topics.
+ * When the budget is exceeded, decoded images are evicted least recently used first,
+ * their raw payload stays, so they can be decoded again on demand.
+ */
+class PayloadCache
+{
+public:
+    /*!
+     * @brief Set budget, images are evicted immediately if it is exceeded
+     * @param bytes Budget in bytes
+     */
+    void setBudget(qint64 bytes);
+
+    //! Budget in bytes
+    qint64 getBudget();
+
+    //! Bytes of raw payloads and decoded images in memory
+    qint64 getTotal();
+
+    //! Whether raw payloads alone exceed the budget
+    bool isOverBudget();
+
+    /*!
+     * @brief Charge raw payload
+     * @param account Account of topic
+     * @param bytes Number of bytes
+     */
+    void addRaw(PayloadAccount *account, qint64 bytes);
+
+    /*!
+     * @brief Release raw payload
+     * @param account Account of topic
+     * @param bytes Number of bytes
+     */
+    void removeRaw(PayloadAccount *account, qint64 bytes);
+
+    /*!
+     * @brief Keep decoded image, it is not kept if it alone exceeds the budget
+     * @param id Message id
+     * @param pixmap Decoded image
+     * @param account Account of topic
+     */
+    void insert(quint64 id, QPixmap pixmap, PayloadAccount *account);
+
+    /*!
+     * @brief Find decoded image and mark it as the most recently used
+     * @param id Message id
+     * @returns image, null pixmap if it is not in cache
+     */
+    QPixmap find(quint64 id);
+
+    /*!
+     * @brief Remove decoded image
+     * @param id Message id
+     */
+    void remove(quint64 id);
+
+    //! Remove all images and forget raw payloads, accounts are not updated as they are released together with topics
+    void clear();
+
+private:
+    //! Evict images until the budget is met or no image is left
+    void evict();
+
+    //! Decoded images by message id
+    QHash<quint64, PayloadCacheEntry> entries;
+
+    //! Message ids of images, the least recently used first
+    std::list<quint64> order;
+
+    //! Budget in bytes
+    qint64 budget = 0;
+
+    //! Bytes of raw payloads
+    qint64 raw = 0;
+
+    //! Bytes of decoded images
+    qint64 decoded = 0;
+};
+
+#endif
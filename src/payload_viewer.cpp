@@ -0,0 +1,185 @@
+/*!
+ * @file payload_viewer.cpp
+ * @author Michal Šlesár (xslesa01)
+ * @author Erik Belko (xbelko02)
+ * @brief Implementation of PayloadViewer
+ */
+
+#include "payload_viewer.h"
+
+#include <cstring>
+#include <algorithm>
+
+#include <QString>
+#include <QPainter>
+#include <QScrollBar>
+#include <QTextCodec>
+#include <QFontDatabase>
+
+PayloadViewer::PayloadViewer(QWidget *parent) : QAbstractScrollArea(parent)
+{
+    setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    viewport()->setBackgroundRole(QPalette::Base);
+}
+
+void PayloadViewer::setPayload(QByteArray payload)
+{
+    this->payload = payload;
+    lineIndex.clear();
+    lineCount = 0;
+
+    setMode(isBinary(payload) ? Hex : Text);
+}
+
+void PayloadViewer::setMode(Mode mode)
+{
+    this->mode = mode;
+
+    // Text rows are indexed only once the text mode is used
+    if(mode == Text && lineIndex.isEmpty() && !payload.isEmpty())
+        buildLineIndex();
+
+    verticalScrollBar()->setValue(0);
+    horizontalScrollBar()->setValue(0);
+    updateScrollBars();
+    viewport()->update();
+}
+
+PayloadViewer::Mode PayloadViewer::getMode()
+{
+    return mode;
+}
+
+bool PayloadViewer::isBinary(const QByteArray &payload)
+{
+    // Prefix is enough to decide, it must not end in the middle of character
+    auto size = std::min(payload.size(), 4096);
+    while(size > 0 && size < payload.size() && (payload[size] & 0xC0) == 0x80)
+        size--;
+
+    if(std::memchr(payload.constData(), 0, size) != Q_NULLPTR)
+        return true;
+
+    QTextCodec::ConverterState state;
+    QTextCodec::codecForName("UTF-8")->toUnicode(payload.constData(), size, &state);
+
+    return state.invalidChars > 0;
+}
+
+void PayloadViewer::buildLineIndex()
+{
+    auto row = 0;
+
+    for(auto offset = 0; offset < payload.size(); offset = nextRow(offset), row++)
+        if(row % indexStep == 0)
+            lineIndex.append(offset);
+
+    lineCount = row;
+}
+
+int PayloadViewer::rowStart(int row) const
+{
+    auto offset = lineIndex[row / indexStep];
+
+    for(auto i = 0; i < row % indexStep; i++)
+        offset = nextRow(offset);
+
+    return offset;
+}
+
+int PayloadViewer::nextRow(int offset) const
+{
+    auto data = payload.constData();
+    auto end = std::min(payload.size(), offset + maxLineLength);
+
+    auto newline = static_cast<const char*>(std::memchr(data + offset, '\n', end - offset));
+    if(newline != Q_NULLPTR)
+        return newline - data + 1;
+
+    // Wrapped line must not split character
+    if(end < payload.size())
+        while(end > offset + 1 && (data[end] & 0xC0) == 0x80)
+            end--;
+
+    return end;
+}
+
+int PayloadViewer::rowCount() const
+{
+    return mode == Hex ? (payload.size() + bytesPerRow - 1) / bytesPerRow : lineCount;
+}
+
+void PayloadViewer::updateScrollBars()
+{
+    auto metrics = fontMetrics();
+    auto visibleRows = std::max(1, viewport()->height() / metrics.height());
+
+    verticalScrollBar()->setRange(0, std::max(0, rowCount() - visibleRows));
+    verticalScrollBar()->setPageStep(visibleRows);
+
+    // Offset, hex bytes and their characters, text rows are as wide as the longest possible row
+    auto columns = mode == Hex ? 10 + bytesPerRow * 3 + 1 + bytesPerRow : maxLineLength;
+    auto width = columns * metrics.horizontalAdvance('0');
+
+    horizontalScrollBar()->setRange(0, std::max(0, width - viewport()->width()));
+    horizontalScrollBar()->setPageStep(viewport()->width());
+}
+
+void PayloadViewer::resizeEvent(QResizeEvent *event)
+{
+    QAbstractScrollArea::resizeEvent(event);
+    updateScrollBars();
+}
+
+void PayloadViewer::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event);
+
+    QPainter painter(viewport());
+    painter.setFont(font());
+
+    auto metrics = fontMetrics();
+    auto lineHeight = metrics.height();
+    auto x = 4 - horizontalScrollBar()->value();
+    auto first = verticalScrollBar()->value();
+    auto last = std::min(rowCount(), first + viewport()->height() / lineHeight + 1);
+    auto data = reinterpret_cast<const uchar*>(payload.constData());
+
+    // Only rows in viewport are formatted
+    auto offset = mode == Text && first < last ? rowStart(first) : 0;
+
+    for(auto row = first; row < last; row++)
+    {
+        QString text;
+
+        if(mode == Hex)
+        {
+            auto start = row * bytesPerRow;
+            auto end = std::min(payload.size(), start + bytesPerRow);
+
+            text.reserve(10 + bytesPerRow * 4 + 1);
+            text += QString("%1  ").arg(start, 8, 16, QChar('0'));
+
+            for(auto i = start; i < start + bytesPerRow; i++)
+                text += i < end ? QString("%1 ").arg(data[i], 2, 16, QChar('0')) : QString("   ");
+
+            text += ' ';
+
+            for(auto i = start; i < end; i++)
+                text += data[i] >= 0x20 && data[i] < 0x7F ? QChar(data[i]) : QChar('.');
+        }
+        else
+        {
+            auto end = nextRow(offset);
+            auto length = end - offset;
+
+            while(length > 0 && (data[offset + length - 1] == '\n' || data[offset + length - 1] == '\r'))
+                length--;
+
+            text = QString::fromUtf8(payload.constData() + offset, length).replace('\t', "    ");
+            offset = end;
+        }
+
+        painter.drawText(x, (row - first) * lineHeight + metrics.ascent(), text);
+    }
+}
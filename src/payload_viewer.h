@@ -0,0 +1,111 @@
+/*!
+ * @file payload_viewer.h
+ * @author Michal Šlesár (xslesa01)
+ * @author Erik Belko (xbelko02)
+ * @brief Viewer of large payloads
+ */
+
+#ifndef E_PAYLOAD_VIEWER_H
+#define E_PAYLOAD_VIEWER_H
+
+#include <QVector>
+#include <QByteArray>
+#include <QAbstractScrollArea>
+
+/*!
+ * @brief Scrollable text or hex view of payload
+ *
+ * Only rows inside the viewport are formatted when painting, the payload itself is shared and never copied.
+ * Text mode keeps start offset of every indexStep-th row, other rows are found by scanning from the nearest
+ * indexed one, so memory does not grow with the payload. Lines longer than maxLineLength are wrapped.
+ */
+class PayloadViewer : public QAbstractScrollArea
+{
+    Q_OBJECT
+
+public:
+    //! How the payload is shown
+    enum Mode { Text, Hex };
+
+    /*!
+     * @brief Constructor
+     * @param parent Parent widget
+     */
+    PayloadViewer(QWidget *parent = Q_NULLPTR);
+
+    /*!
+     * @brief Show payload, binary payloads are shown in hex mode
+     * @param payload Payload
+     */
+    void setPayload(QByteArray payload);
+
+    /*!
+     * @brief Switch mode
+     * @param mode Mode
+     */
+    void setMode(Mode mode);
+
+    //! Current mode
+    Mode getMode();
+
+    /*!
+     * @brief Check beginning of payload for bytes that do not belong to text
+     * @param payload Payload
+     * @returns true if payload contains zero byte or invalid UTF-8
+     */
+    static bool isBinary(const QByteArray &payload);
+
+    //! Bytes shown in one row of hex mode
+    static constexpr int bytesPerRow = 16;
+
+    //! Longest row of text mode in bytes
+    static constexpr int maxLineLength = 512;
+
+    //! Every how many rows of text mode the start offset is remembered
+    static constexpr int indexStep = 1024;
+
+protected:
+    //! Draw visible rows
+    void paintEvent(QPaintEvent *event) override;
+
+    //! Update scroll bars for new size
+    void resizeEvent(QResizeEvent *event) override;
+
+private:
+    //! Scan text once and remember offsets of every indexStep-th row
+    void buildLineIndex();
+
+    /*!
+     * @brief Find start of row of text mode
+     * @param row Row
+     * @returns offset in payload
+     */
+    int rowStart(int row) const;
+
+    /*!
+     * @brief Find start of the next row of text mode
+     * @param offset Start of row
+     * @returns offset of the next row
+     */
+    int nextRow(int offset) const;
+
+    //! Number of rows in current mode
+    int rowCount() const;
+
+    //! Set ranges of scroll bars
+    void updateScrollBars();
+
+    //! Shown payload
+    QByteArray payload;
+
+    //! Current mode
+    Mode mode = Text;
+
+    //! Start offsets of every indexStep-th row of text mode
+    QVector<int> lineIndex;
+
+    //! Number of rows of text mode
+    int lineCount = 0;
+};
+
+#endif
@@ -0,0 +1,166 @@
+/*!
+ * @file search_index.cpp
+ * @author Michal Šlesár (xslesa01)
+ * @author Erik Belko (xbelko02)
+ * @brief Implementation of SearchIndex
+ */
+
+#include "search_index.h"
+
+#include <algorithm>
+
+#include <QList>
+
+qint64 SearchIndex::add(quint64 id, QString topic, QString text, qint64 time)
+{
+    SearchDocument document;
+    document.topic = topic;
+    document.text = text.left(maxTextLength);
+    document.time = time;
+    document.truncated = text.length() > maxTextLength;
+
+    auto keys = trigrams(document.text.toLower());
+    for(auto key : keys)
+        postings[key].append(id);
+
+    // Strings, one posting per trigram and the map node of the document
+    document.cost = (document.topic.size() + document.text.size()) * (qint64) sizeof(QChar) 
+        + keys.count() * (qint64) sizeof(quint64) + (qint64) sizeof(SearchDocument) + 4 * (qint64) sizeof(void*);
+
+    documents.insert(id, document);
+    return document.cost;
+}
+
+qint64 SearchIndex::remove(quint64 id)
+{
+    auto it = documents.find(id);
+    if(it == documents.end())
+        return 0;
+
+    auto cost = it->cost;
+    documents.erase(it);
+
+    // Posting lists are cleaned up in bulk
+    removed++;
+    if(removed > 1024 && removed > documents.count())
+        compact();
+
+    return cost;
+}
+
+void SearchIndex::clear()
+{
+    documents.clear();
+    postings.clear();
+    removed = 0;
+}
+
+int SearchIndex::count()
+{
+    return documents.count();
+}
+
+QVector<SearchResult> SearchIndex::find(QString query, int limit)
+{
+    QVector<SearchResult> results;
+
+    auto anchored = query.startsWith("^");
+    auto needle = query.mid(anchored ? 1 : 0).toLower();
+
+    if(needle.isEmpty())
+        return results;
+
+    auto addResult = [&](quint64 id, const SearchDocument &document) {
+        SearchResult result;
+        result.id = id;
+        result.document = document;
+        results.append(result);
+    };
+
+    // Too short for trigrams, check messages from the newest until there are enough results
+    if(needle.length() < 3)
+    {
+        for(auto it = documents.constEnd(); it != documents.constBegin() && results.count() < limit;)
+        {
+            --it;
+            if(matches(it.value(), needle, anchored))
+                addResult(it.key(), it.value());
+        }
+
+        return results;
+    }
+
+    // Intersect from the shortest posting list, the others are binary searched
+    QList<const QVector<quint64>*> lists;
+    for(auto key : trigrams(needle))
+    {
+        auto it = postings.constFind(key);
+        if(it == postings.constEnd())
+            return results;
+
+        lists.append(&it.value());
+    }
+
+    std::sort(lists.begin(), lists.end(), [](const QVector<quint64> *a, const QVector<quint64> *b) {
+        return a->count() < b->count();
+    });
+
+    auto &shortest = *lists.first();
+    for(auto i = shortest.count() - 1; i >= 0; i--)
+    {
+        auto id = shortest[i];
+        auto found = true;
+
+        for(auto l = 1; l < lists.count() && found; l++)
+            found = std::binary_search(lists[l]->begin(), lists[l]->end(), id);
+
+        if(!found)
+            continue;
+
+        // Trigrams do not guarantee their order, so the text is checked
+        auto it = documents.constFind(id);
+        if(it == documents.constEnd() || !matches(it.value(), needle, anchored))
+            continue;
+
+        addResult(id, it.value());
+
+        if(results.count() >= limit)
+            break;
+    }
+
+    return results;
+}
+
+QVector<quint64> SearchIndex::trigrams(const QString &text)
+{
+    QVector<quint64> keys;
+
+    for(auto i = 0; i + 3 <= text.length(); i++)
+    {
+        auto key = (quint64) text[i].unicode() << 32 | (quint64) text[i + 1].unicode() << 16 | text[i + 2].unicode();
+        keys.append(key);
+    }
+
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    return keys;
+}
+
+bool SearchIndex::matches(const SearchDocument &document, const QString &query, bool anchored)
+{
+    if(anchored)
+        return document.text.startsWith(query, Qt::CaseInsensitive);
+
+    return document.text.contains(query, Qt::CaseInsensitive);
+}
+
+void SearchIndex::compact()
+{
+    postings.clear();
+    removed = 0;
+
+    for(auto it = documents.constBegin(); it != documents.constEnd(); ++it)
+        for(auto key : trigrams(it.value().text.toLower()))
+            postings[key].append(it.key());
+}
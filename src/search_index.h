@@ -0,0 +1,124 @@
+/*!
+ * @file search_index.h
+ * @author Michal Šlesár (xslesa01)
+ * @author Erik Belko (xbelko02)
+ * @brief Full-text search over message history
+ */
+
+#ifndef E_SEARCH_INDEX_H
+#define E_SEARCH_INDEX_H
+
+#include <QMap>
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+//! Text message in search index
+class SearchDocument
+{
+public:
+    //! Topic path
+    QString topic;
+
+    //! Beginning of the text payload
+    QString text;
+
+    //! Time the message was received (in milliseconds since epoch)
+    qint64 time = 0;
+
+    //! Whether the text payload is longer than the indexed part
+    bool truncated = false;
+
+    //! Estimated memory used by the message in index
+    qint64 cost = 0;
+};
+
+//! Message matching search query
+class SearchResult
+{
+public:
+    //! Message id
+    quint64 id = 0;
+
+    //! Matching message
+    SearchDocument document;
+};
+
+/*!
+ * @brief Inverted index of trigrams of text messages
+ *
+ * Messages are added as they enter the history and removed once they leave it. Posting lists are
+ * ordered by message id, removed messages are skipped while querying and dropped from posting
+ * lists when they outnumber the live ones.
+ *
+ * Query is matched as case insensitive substring, query starting with "^" matches only
+ * the beginning of the text. Queries shorter than a trigram scan messages from the newest until the limit is reached.
+ */
+class SearchIndex
+{
+public:
+    /*!
+     * @brief Add text message, ids must be increasing
+     * @param id Message id
+     * @param topic Topic path
+     * @param text Text payload, only its first maxTextLength characters are indexed
+     * @param time Time the message was received (in milliseconds since epoch)
+     * @returns estimated memory used by the message in index
+     */
+    qint64 add(quint64 id, QString topic, QString text, qint64 time);
+
+    /*!
+     * @brief Remove message, unknown ids are ignored
+     * @param id Message id
+     * @returns memory released by the message, 0 if it was not indexed
+     */
+    qint64 remove(quint64 id);
+
+    //! Remove all messages
+    void clear();
+
+    /*!
+     * @brief Find messages containing query
+     * @param query Query
+     * @param limit Maximum number of results
+     * @returns matching messages, the newest first
+     */
+    QVector<SearchResult> find(QString query, int limit);
+
+    //! Number of indexed messages
+    int count();
+
+    //! How many characters of each text payload are indexed, longer messages are marked as truncated
+    static constexpr int maxTextLength = 4096;
+
+private:
+    /*!
+     * @brief Split text into distinct trigram keys
+     * @param text Lower case text
+     * @returns trigram keys
+     */
+    static QVector<quint64> trigrams(const QString &text);
+
+    /*!
+     * @brief Check the text of candidate message
+     * @param document Message
+     * @param query Lower case query without anchor
+     * @param anchored Whether the query must match the beginning
+     * @returns true if the message matches
+     */
+    static bool matches(const SearchDocument &document, const QString &query, bool anchored);
+
+    //! Rebuild posting lists from live messages
+    void compact();
+
+    //! Live messages ordered by id, so they can be walked from the newest
+    QMap<quint64, SearchDocument> documents;
+
+    //! Message ids by trigram key in increasing order
+    QHash<quint64, QVector<quint64>> postings;
+
+    //! Number of removed messages still referenced by posting lists
+    int removed = 0;
+};
+
+#endif
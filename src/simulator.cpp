@@ -8,6 +8,7 @@
 #include "simulator.h"
 
 #include <random>
+#include <algorithm>
 
 #include <QUuid>
 #include <QObject>
@@ -26,8 +27,17 @@
 Simulator::Simulator(Explorer *explorer) : QObject(explorer), explorer(explorer)
 {
     client = new Client(this);
+    client->setInflightWindow(explorer->getInflight());
+    client->setPublishQos(explorer->getPublishQos());
+    client->setDecodePayloads(false);
+
+    probe = new Client(this);
+    probe->setDecodePayloads(false);
+
+    connect(probe, &Client::receivedProperties, this, &Simulator::onProbeMessage);
 
     connect(&updateTimer, &QTimer::timeout, this, &Simulator::onTimeout);
+    connect(client, &Client::connectionFailed, this, &Simulator::onConnectionFailed);
 }
 
 bool Simulator::loadConfiguration()
@@ -41,6 +51,8 @@ bool Simulator::loadConfiguration()
         return false;
     }
 
+    measure = document.object().value("measure").toBool(false);
+
     // Result of topics parse
     // We check this variable after iteration and delete all parsed topics if failed
     auto parseResult = true;
@@ -93,9 +105,16 @@ bool Simulator::loadConfiguration()
         for(auto topic : topics)
             delete topic;
 
+        topics.clear();
         return false;
     }
 
+    for(auto topic : topics)
+    {
+        if(!topicIndex.contains(topic->name))
+            topicIndex.insert(topic->name, topic);
+    }
+
     return true;
 }
 
@@ -119,13 +138,43 @@ bool Simulator::start(QString address)
         return false;
     }
 
+    if(measure)
+    {
+        // Start measuring from scratch, the second connection subscribes all simulated topics
+        for(auto topic : topics)
+            topic->measurement = SimulatorMeasurement();
+
+        clock.start();
+
+        if(probe->connect(address))
+        {
+            for(auto name : topicIndex.keys())
+                probe->subscribe(name);
+        }
+        else
+            explorer->setStatus("Simulator failed to start measuring connection");
+    }
+
     running = true;
 
+    // Messages generated before the connection is established wait in the publish queue
     updateTimer.start(1000);
     explorer->setStatus("Simulator started!");
     return true;
 }
 
+void Simulator::onConnectionFailed()
+{
+    if(!running)
+        return;
+
+    running = false;
+    updateTimer.stop();
+
+    explorer->setStatus("Simulator failed to connect to the server");
+    emit stopped();
+}
+
 void Simulator::onTimeout()
 {
     for(auto topic : topics)
@@ -143,13 +192,25 @@ void Simulator::onTimeout()
         auto message = topic->messages[(int) distribution(generator)];
 
         // Only string and ByteArray types are supported
+        QByteArray payload;
         if(message.userType() == QMetaType::QString)
-            client->publish(topic->name, qvariant_cast<QString>(message));
+            payload = qvariant_cast<QString>(message).toUtf8();
         else if(message.userType() == QMetaType::QByteArray)
-            client->publish(topic->name, qvariant_cast<QByteArray>(message));
+            payload = qvariant_cast<QByteArray>(message);
         else 
             continue;
 
+        // Sequence number and send time are sent as user properties, so the payload stays as configured
+        QMap<QString, QString> properties;
+        if(measure)
+        {
+            auto sequence = topicIndex.value(topic->name)->measurement.nextSequence++;
+            properties.insert(sequenceProperty, QString::number(sequence));
+            properties.insert(timeProperty, QString::number(clock.nsecsElapsed() / 1000));
+        }
+
+        client->publish(topic->name, payload, properties);
+
         topic->lastSendTime = QDateTime::currentDateTime();
     }
 }
@@ -164,6 +225,121 @@ void Simulator::stop()
 
     client->disconnect();
     explorer->setStatus("Simulator stopped!");
+    emit stopped();
+
+    if(measure)
+    {
+        probe->disconnect();
+        Utils::openText(measurementReport(), explorer);
+    }
+}
+
+void Simulator::onProbeMessage(QString topic, QMap<QString, QString> properties)
+{
+    // Latency includes time the message waited in event loop of GUI thread
+    auto now = clock.nsecsElapsed() / 1000;
+
+    auto simulatorTopic = topicIndex.value(topic, Q_NULLPTR);
+    if(!running || simulatorTopic == Q_NULLPTR)
+        return;
+
+    // Messages of other publishers do not carry both properties
+    bool isSequence, isTime;
+    auto sequence = properties.value(sequenceProperty).toULongLong(&isSequence);
+    auto time = properties.value(timeProperty).toLongLong(&isTime);
+    if(!isSequence || !isTime)
+        return;
+
+    auto &measurement = simulatorTopic->measurement;
+    measurement.received++;
+
+    if(!measurement.anyReceived)
+    {
+        measurement.anyReceived = true;
+        measurement.firstSequence = sequence;
+        measurement.highestSequence = sequence;
+    }
+    else if(measurement.recentSequences.contains(sequence))
+    {
+        measurement.duplicates++;
+        return;
+    }
+    else if(sequence < measurement.highestSequence)
+        measurement.reordered++;
+    else
+        measurement.highestSequence = sequence;
+
+    // Messages sent before the first received one are not part of the measurement
+    measurement.firstSequence = std::min(measurement.firstSequence, sequence);
+
+    measurement.recentSequences.insert(sequence);
+    if(measurement.recentSequences.count() > (int) SimulatorMeasurement::duplicateWindow * 2)
+    {
+        auto oldest = measurement.highestSequence - std::min(measurement.highestSequence, SimulatorMeasurement::duplicateWindow);
+        auto it = measurement.recentSequences.begin();
+        while(it != measurement.recentSequences.end())
+        {
+            if(*it < oldest)
+                it = measurement.recentSequences.erase(it);
+            else
+                ++it;
+        }
+    }
+
+    if(measurement.latencies.count() < SimulatorMeasurement::maxLatencies)
+        measurement.latencies.append(now - time);
+    else
+        measurement.latencies[measurement.nextLatency] = now - time;
+
+    measurement.nextLatency = (measurement.nextLatency + 1) % SimulatorMeasurement::maxLatencies;
+}
+
+QString Simulator::measurementReport()
+{
+    // Percentile of sorted samples (in milliseconds)
+    auto percentile = [](const QVector<qint64> &sorted, double p) {
+        if(sorted.isEmpty())
+            return QString("-");
+
+        auto index = std::min(sorted.count() - 1, (int) (p * sorted.count()));
+        return QString::number(sorted[index] / 1000.0, 'f', 2);
+    };
+
+    auto statistics = client->getPublishStatistics();
+
+    QString report;
+    report += QString("Published: %1 acked, %2 failed, %3 not acknowledged\n\n")
+        .arg(statistics.acked).arg(statistics.failed).arg(statistics.pending + statistics.queued);
+    report += "topic: received, lost, duplicates, reordered, latency p50 / p95 / p99 (ms)\n";
+
+    for(auto name : topicIndex.keys())
+    {
+        auto &measurement = topicIndex[name]->measurement;
+
+        // Messages after the highest received one may still be on the way, they are not counted as lost
+        quint64 lost = 0;
+        if(measurement.anyReceived)
+        {
+            auto expected = measurement.highestSequence - measurement.firstSequence + 1;
+            auto unique = measurement.received - measurement.duplicates;
+            lost = expected > unique ? expected - unique : 0;
+        }
+
+        auto sorted = measurement.latencies;
+        std::sort(sorted.begin(), sorted.end());
+
+        report += QString("%1: %2, %3, %4, %5, %6 / %7 / %8\n")
+            .arg(name)
+            .arg(measurement.received)
+            .arg(lost)
+            .arg(measurement.duplicates)
+            .arg(measurement.reordered)
+            .arg(percentile(sorted, 0.50))
+            .arg(percentile(sorted, 0.95))
+            .arg(percentile(sorted, 0.99));
+    }
+
+    return report;
 }
 
 bool Simulator::isRunning()
@@ -174,6 +350,7 @@ bool Simulator::isRunning()
 Simulator::~Simulator()
 {
     delete client;
+    delete probe;
     for(auto topic : topics)
         delete topic;
 }
\ No newline at end of file
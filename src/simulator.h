@@ -8,12 +8,18 @@
 #ifndef E_SIMULATOR_H
 #define E_SIMULATOR_H
 
+#include <QElapsedTimer>
+#include <QByteArray>
 #include <QDateTime>
 #include <QVariant>
+#include <QVector>
 #include <QString>
 #include <QObject>
 #include <QTimer>
+#include <QMap>
+#include <QHash>
 #include <QList>
+#include <QSet>
 
 #include "explorer.h"
 #include "client.h"
@@ -22,6 +28,47 @@
 class Explorer;
 class Client;
 
+//! Round trip measurement of one simulated topic
+class SimulatorMeasurement
+{
+public:
+    //! How many latency samples are kept for percentiles
+    static constexpr int maxLatencies = 4096;
+
+    //! How far behind the highest sequence number are duplicates detected
+    static constexpr quint64 duplicateWindow = 1024;
+
+    //! Sequence number of the next published message
+    quint64 nextSequence = 0;
+
+    //! Messages received back
+    quint64 received = 0;
+
+    //! Messages received more than once
+    quint64 duplicates = 0;
+
+    //! Messages received after a message with higher sequence number
+    quint64 reordered = 0;
+
+    //! Whether any message was received back
+    bool anyReceived = false;
+
+    //! First sequence number received back, earlier messages were sent before subscription was active
+    quint64 firstSequence = 0;
+
+    //! Highest sequence number received back
+    quint64 highestSequence = 0;
+
+    //! Sequence numbers received recently, used to tell duplicates from reordered messages
+    QSet<quint64> recentSequences;
+
+    //! Ring buffer of round trip latencies (in microseconds)
+    QVector<qint64> latencies;
+
+    //! Position of the next latency sample in ring buffer
+    int nextLatency = 0;
+};
+
 //! Stores topic information used in Simulator
 class SimulatorTopic
 {
@@ -37,12 +84,19 @@ public:
 
     //! List of possible messages to this topic
     QList<QVariant> messages;
+
+    //! Round trip measurement, used only when measuring is turned on
+    SimulatorMeasurement measurement;
 };
 
 /*!
  * @brief Simulation of traffic on MQTT server
  * 
  * Simulator loads configuration from JSON file and then sends random message from list of messages every period
+ *
+ * When the configuration contains "measure": true, every message carries sequence number and send time in MQTT v5 user properties.
+ * A second connection subscribes the simulated topics and measures round trip latency, loss, duplicates and reordering
+ * per topic, the report is shown when the Simulator is stopped.
  */
 class Simulator : public QObject
 {
@@ -64,7 +118,7 @@ public:
      * When this function is called the first time, user is prompted to select configuration file
      * 
      * @param address Hostname
-     * @returns false if user did not select configuration file, connection to server failed or the Simulator is already running, 
+     * @returns false if user did not select configuration file, connection could not be started or the Simulator is already running, 
      *          true otherwise
      */
     bool start(QString address);
@@ -75,10 +129,24 @@ public:
     //! This property holds whether the Simulator is running 
     bool isRunning();
 
+signals:
+    //! Signal that the Simulator was stopped
+    void stopped();
+
 private slots:
     //! This slot is called on every updateTimer tick
     void onTimeout();
 
+    //! This slot is called when client fails to connect to the server
+    void onConnectionFailed();
+
+    /*!
+     * @brief This slot is called when measuring connection receives message with user properties
+     * @param topic Topic
+     * @param properties MQTT v5 user properties of the message
+     */
+    void onProbeMessage(QString topic, QMap<QString, QString> properties);
+
 private:
     /*! 
      * @brief Open FileDialog so user can select configuration file containing list of messages 
@@ -86,12 +154,36 @@ private:
      */
     bool loadConfiguration();
 
+    /*!
+     * @brief Build measurement report of all topics
+     * @returns human readable report
+     */
+    QString measurementReport();
+
     //! Explorer instance
     Explorer *explorer;
 
     //! Client instance
     Client *client;
 
+    //! Second connection that receives simulated messages back when measuring
+    Client *probe;
+
+    //! User property holding sequence number of simulated message
+    static constexpr const char *sequenceProperty = "sim-sequence";
+
+    //! User property holding send time of simulated message (in microseconds)
+    static constexpr const char *timeProperty = "sim-time";
+
+    //! Whether round trip measurement is turned on
+    bool measure = false;
+
+    //! Time base of send timestamps
+    QElapsedTimer clock;
+
+    //! Topics by name, used to match received messages when measuring
+    QHash<QString, SimulatorTopic*> topicIndex;
+
     //! Timer that runs every second
     QTimer updateTimer;
 
@@ -0,0 +1,367 @@
+/*!
+ * @file snapshot.cpp
+ * @author Michal Šlesár (xslesa01)
+ * @author Erik Belko (xbelko02)
+ * @brief Implementation of Snapshot
+ */
+
+#include "snapshot.h"
+
+#include <climits>
+#include <cstring>
+#include <algorithm>
+
+#include <QDir>
+#include <QFile>
+#include <QBuffer>
+#include <QThread>
+#include <QImageReader>
+
+#include "utils.h"
+
+SnapshotWorker::SnapshotWorker(std::shared_ptr<SnapshotJob> job) : job(job) {}
+
+void SnapshotWorker::run()
+{
+    // Workers take entries one by one, so slow entries do not block the others
+    while(!job->cancelled)
+    {
+        auto index = job->next++;
+        if(index >= job->entries.count())
+            break;
+
+        if(!write(job->entries[index]))
+            job->failed++;
+
+        job->done++;
+    }
+
+    job->running--;
+}
+
+bool SnapshotWorker::write(const SnapshotEntry &entry)
+{
+    auto path = job->target + "/" + entry.path;
+
+    // mkpath tolerates directories created concurrently by other workers
+    if(!QDir().mkpath(path))
+        return false;
+
+    if(!entry.hasMessage)
+        return true;
+
+    // Keep extension of the original image format, payload is not encoded again
+    auto extension = QString("txt");
+    if(entry.isImage)
+    {
+        QBuffer buffer;
+        buffer.setData(entry.payload);
+        buffer.open(QIODevice::ReadOnly);
+        auto format = QImageReader::imageFormat(&buffer);
+        extension = format == "jpeg" ? QString("jpg") : QString::fromLatin1(format);
+
+        if(extension.isEmpty())
+            extension = "bin";
+    }
+
+    auto fileName = "payload." + extension;
+    if(!Utils::writeFile(path + "/" + fileName, entry.payload))
+        return false;
+
+    // Payload of topic whose format changed was written under another extension by previous snapshot
+    QDir directory(path);
+    for(auto previous : directory.entryList(QStringList() << "payload.*", QDir::Files))
+        if(previous != fileName && !directory.remove(previous))
+            return false;
+
+    return true;
+}
+
+/*!
+ * @brief Append little endian number to buffer
+ * @param buffer Buffer
+ * @param value Number
+ * @param size Number of bytes
+ */
+static void appendNumber(QByteArray &buffer, quint64 value, int size)
+{
+    for(auto i = 0; i < size; i++)
+        buffer.append((char) ((value >> (8 * i)) & 0xff));
+}
+
+/*!
+ * @brief Read little endian number
+ * @param data Pointer to the first byte
+ * @param size Number of bytes
+ * @returns number
+ */
+static quint64 readNumber(const uchar *data, int size)
+{
+    quint64 value = 0;
+    for(auto i = 0; i < size; i++)
+        value |= (quint64) data[i] << (8 * i);
+
+    return value;
+}
+
+SnapshotArchiveWorker::SnapshotArchiveWorker(std::shared_ptr<SnapshotJob> job) : job(job) {}
+
+void SnapshotArchiveWorker::run()
+{
+    QFile file(job->target);
+
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || !write(file) || job->cancelled)
+    {
+        // Archive is useless when incomplete
+        file.close();
+        file.remove();
+
+        if(!job->cancelled)
+        {
+            job->failed = job->entries.count();
+            job->done = job->entries.count();
+        }
+    }
+
+    job->running--;
+}
+
+bool SnapshotArchiveWorker::write(QFile &file)
+{
+    QByteArray buffer;
+    buffer.append(Snapshot::archiveMagic, 4);
+    appendNumber(buffer, Snapshot::archiveVersion, 4);
+
+    // Delta archive references its base
+    if(!job->base.isEmpty())
+    {
+        auto base = job->base.toUtf8();
+        appendNumber(buffer, base.size(), 4);
+        buffer.append(base);
+    }
+
+    // Topic dictionary follows the header
+    quint64 dictionaryOffset = buffer.size();
+    for(auto &entry : job->entries)
+    {
+        auto path = entry.path.toUtf8();
+        appendNumber(buffer, path.size(), 4);
+        buffer.append(path);
+    }
+
+    if(file.write(buffer) != buffer.size())
+        return false;
+
+    // Payload heap, index is collected while payloads are streamed to the file
+    quint64 offset = buffer.size();
+    QByteArray index;
+    index.reserve(job->entries.count() * (int) Snapshot::archiveIndexEntrySize);
+
+    for(auto &entry : job->entries)
+    {
+        if(job->cancelled)
+            return false;
+
+        quint32 flags = (entry.hasMessage ? 1 : 0) | (entry.isImage ? 2 : 0) | (entry.local ? 4 : 0);
+        appendNumber(index, offset, 8);
+        appendNumber(index, entry.payload.size(), 8);
+        appendNumber(index, entry.time, 8);
+        appendNumber(index, flags, 4);
+        appendNumber(index, 0, 4);
+
+        if(!entry.payload.isEmpty() && file.write(entry.payload) != entry.payload.size())
+            return false;
+
+        offset += entry.payload.size();
+        job->done++;
+    }
+
+    quint64 indexOffset = offset;
+    if(file.write(index) != index.size())
+        return false;
+
+    QByteArray footer;
+    appendNumber(footer, dictionaryOffset, 8);
+    appendNumber(footer, indexOffset, 8);
+    appendNumber(footer, job->entries.count(), 4);
+    appendNumber(footer, job->base.isEmpty() ? 0 : 1, 4);
+    footer.append(Snapshot::archiveMagic, 4);
+    appendNumber(footer, Snapshot::archiveVersion, 4);
+
+    if(file.write(footer) != footer.size())
+        return false;
+
+    return file.flush();
+}
+
+Snapshot::Snapshot(QObject *parent) : QObject(parent)
+{
+    pool.setMaxThreadCount(QThread::idealThreadCount());
+
+    connect(&progressTimer, &QTimer::timeout, this, &Snapshot::onProgressTimeout);
+}
+
+bool Snapshot::start(QString directory, QVector<SnapshotEntry> entries)
+{
+    return startJob(directory, entries, false, QString());
+}
+
+bool Snapshot::startArchive(QString fileName, QVector<SnapshotEntry> entries, QString base)
+{
+    return startJob(fileName, entries, true, base);
+}
+
+bool Snapshot::startJob(QString target, QVector<SnapshotEntry> entries, bool archive, QString base)
+{
+    if(job)
+        return false;
+
+    job = std::make_shared<SnapshotJob>();
+    job->target = target;
+    job->base = base;
+    job->entries = entries;
+
+    // Archive is written in one streaming pass, directory structure in parallel
+    // No point in starting more workers than there are entries
+    auto workers = archive ? 1 : std::max(1, std::min(pool.maxThreadCount(), entries.count()));
+    job->running = workers;
+
+    for(auto i = 0; i < workers; i++)
+    {
+        if(archive)
+            pool.start(new SnapshotArchiveWorker(job));
+        else
+            pool.start(new SnapshotWorker(job));
+    }
+
+    progressTimer.start(100);
+    return true;
+}
+
+bool Snapshot::readArchive(QFile *file, QVector<SnapshotEntry> &entries, QString &base)
+{
+    auto size = file->size();
+    if(size < archiveHeaderSize + archiveFooterSize)
+        return false;
+
+    auto data = file->map(0, size);
+    if(data == Q_NULLPTR)
+        return false;
+
+    auto fail = [&]() {
+        entries.clear();
+        file->unmap(data);
+        return false;
+    };
+
+    // Version 1 archives are full snapshots with the same layout
+    auto footer = data + size - archiveFooterSize;
+    auto version = readNumber(footer + 28, 4);
+    if(std::memcmp(data, archiveMagic, 4) != 0 || std::memcmp(footer + 24, archiveMagic, 4) != 0 || version < 1 || version > archiveVersion)
+        return fail();
+
+    auto dictionaryOffset = readNumber(footer, 8);
+    auto indexOffset = readNumber(footer + 8, 8);
+    auto count = readNumber(footer + 16, 4);
+    auto flags = readNumber(footer + 20, 4);
+
+    // Index must end right where footer starts, every value is checked on its own so the sums below cannot overflow
+    auto indexEnd = (quint64) (size - archiveFooterSize);
+    if(indexOffset > indexEnd || count > (indexEnd - indexOffset) / archiveIndexEntrySize ||
+        indexOffset + count * archiveIndexEntrySize != indexEnd)
+        return fail();
+
+    if(dictionaryOffset < (quint64) archiveHeaderSize || dictionaryOffset > indexOffset)
+        return fail();
+
+    // Base reference lies between header and dictionary
+    base.clear();
+    if(flags & 1)
+    {
+        if(dictionaryOffset < (quint64) archiveHeaderSize + 4)
+            return fail();
+
+        auto length = readNumber(data + archiveHeaderSize, 4);
+        if(length > (quint64) INT_MAX || archiveHeaderSize + 4 + length > dictionaryOffset)
+            return fail();
+
+        base = QString::fromUtf8((const char*) data + archiveHeaderSize + 4, (int) length);
+    }
+
+    entries.reserve(count);
+
+    auto position = dictionaryOffset;
+    for(quint64 i = 0; i < count; i++)
+    {
+        if(position + 4 > indexOffset)
+            return fail();
+
+        auto length = readNumber(data + position, 4);
+        position += 4;
+
+        if(length > (quint64) INT_MAX || position + length > indexOffset)
+            return fail();
+
+        SnapshotEntry entry;
+        entry.path = QString::fromUtf8((const char*) data + position, length);
+        position += length;
+
+        auto record = data + indexOffset + i * archiveIndexEntrySize;
+        auto offset = readNumber(record, 8);
+        auto payloadLength = readNumber(record + 8, 8);
+        auto entryFlags = readNumber(record + 24, 4);
+
+        // Payload must lie inside the heap and fit into QByteArray
+        if(payloadLength > (quint64) INT_MAX || payloadLength > indexOffset || offset > indexOffset - payloadLength)
+            return fail();
+
+        entry.hasMessage = entryFlags & 1;
+        entry.isImage = entryFlags & 2;
+        entry.local = entryFlags & 4;
+        entry.time = (qint64) readNumber(record + 16, 8);
+
+        // Payload is not copied, it points to the mapped file
+        if(payloadLength > 0)
+            entry.payload = QByteArray::fromRawData((const char*) data + offset, (int) payloadLength);
+
+        entries.append(entry);
+    }
+
+    return true;
+}
+
+void Snapshot::cancel()
+{
+    if(job)
+        job->cancelled = true;
+}
+
+bool Snapshot::isRunning()
+{
+    return job != nullptr;
+}
+
+void Snapshot::onProgressTimeout()
+{
+    if(!job)
+        return;
+
+    emit progress(job->done, job->entries.count());
+
+    if(job->running > 0)
+        return;
+
+    progressTimer.stop();
+
+    // Release the job before emitting, so a new export can be started from the slot
+    auto finishedJob = job;
+    job.reset();
+
+    emit finished(finishedJob->done - finishedJob->failed, finishedJob->failed, finishedJob->cancelled);
+}
+
+Snapshot::~Snapshot()
+{
+    cancel();
+    pool.waitForDone();
+}
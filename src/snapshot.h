@@ -0,0 +1,249 @@
+/*!
+ * @file snapshot.h
+ * @author Michal Šlesár (xslesa01)
+ * @author Erik Belko (xbelko02)
+ * @brief Export of topic tree snapshots
+ */
+
+#ifndef E_SNAPSHOT_H
+#define E_SNAPSHOT_H
+
+#include <atomic>
+#include <memory>
+
+#include <QFile>
+#include <QTimer>
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <QRunnable>
+#include <QByteArray>
+#include <QThreadPool>
+
+//! One topic of snapshot
+class SnapshotEntry
+{
+public:
+    //! Topic path
+    QString path;
+
+    //! Raw payload of the last message
+    QByteArray payload;
+
+    //! Whether the topic received any message
+    bool hasMessage = false;
+
+    //! Whether the payload is an image
+    bool isImage = false;
+
+    //! Whether the last message was sent from us
+    bool local = false;
+
+    //! Time the last message was received (in milliseconds since epoch)
+    qint64 time = 0;
+};
+
+//! State of export shared between Snapshot and its workers
+class SnapshotJob
+{
+public:
+    //! Target directory or archive file
+    QString target;
+
+    //! Base archive referenced by delta archive, empty for full snapshot
+    QString base;
+
+    //! Work list
+    QVector<SnapshotEntry> entries;
+
+    //! Index of the next entry to be written
+    std::atomic<int> next { 0 };
+
+    //! Number of processed entries
+    std::atomic<int> done { 0 };
+
+    //! Number of entries that could not be written
+    std::atomic<int> failed { 0 };
+
+    //! Number of workers that did not finish yet
+    std::atomic<int> running { 0 };
+
+    //! Whether the user cancelled the export
+    std::atomic<bool> cancelled { false };
+};
+
+//! Writes entries of snapshot job until the work list is exhausted
+class SnapshotWorker : public QRunnable
+{
+public:
+    /*!
+     * @brief Constructor
+     * @param job Shared export state
+     */
+    SnapshotWorker(std::shared_ptr<SnapshotJob> job);
+
+    //! Write entries
+    void run() override;
+
+private:
+    /*!
+     * @brief Write one entry to target directory
+     * @param entry Snapshot entry
+     * @returns true on success, false otherwise
+     */
+    bool write(const SnapshotEntry &entry);
+
+    //! Shared export state
+    std::shared_ptr<SnapshotJob> job;
+};
+
+//! Writes all entries of snapshot job to single archive file in one streaming pass
+class SnapshotArchiveWorker : public QRunnable
+{
+public:
+    /*!
+     * @brief Constructor
+     * @param job Shared export state
+     */
+    SnapshotArchiveWorker(std::shared_ptr<SnapshotJob> job);
+
+    //! Write archive
+    void run() override;
+
+private:
+    /*!
+     * @brief Write archive file
+     * @param file Opened target file
+     * @returns true on success, false otherwise
+     */
+    bool write(QFile &file);
+
+    //! Shared export state
+    std::shared_ptr<SnapshotJob> job;
+};
+
+/*!
+ * @brief Export of topic tree to directory structure
+ *
+ * Work list is built on GUI thread, files are written from thread pool.
+ * Every topic gets a directory, the last message is stored byte-exact as payload.txt
+ * or payload.<image format> next to it.
+ *
+ * Snapshot can also be written as single archive file, all numbers are little endian:
+ *  - header: magic "MQEA", version (u32)
+ *  - base archive (delta archive only): length (u32) and UTF-8 file name relative to this archive
+ *  - topic dictionary: for every topic length (u32) and UTF-8 path
+ *  - payload heap: payloads of all topics one after another
+ *  - index: for every topic in dictionary order payload offset (u64), payload length (u64),
+ *    time (i64, ms since epoch), flags (u32, 1 = has message, 2 = image, 4 = local), reserved (u32)
+ *  - footer: dictionary offset (u64), index offset (u64), topic count (u32), flags (u32, 1 = delta), magic "MQEA", version (u32)
+ *
+ * Delta archive contains only topics changed since its base archive, topics of delta replace topics of base.
+ */
+class Snapshot : public QObject
+{
+    Q_OBJECT
+
+public:
+    /*!
+     * @brief Constructor
+     * @param parent Parent object
+     */
+    Snapshot(QObject *parent);
+
+    //! Destructor, cancels running export
+    ~Snapshot();
+
+    /*!
+     * @brief Start writing snapshot in background
+     * @param directory Target directory
+     * @param entries Work list
+     * @returns false if another export is running
+     */
+    bool start(QString directory, QVector<SnapshotEntry> entries);
+
+    /*!
+     * @brief Start writing snapshot archive in background
+     * @param fileName Target archive file
+     * @param entries Work list
+     * @param base Base archive relative to target archive when writing delta archive, empty otherwise
+     * @returns false if another export is running
+     */
+    bool startArchive(QString fileName, QVector<SnapshotEntry> entries, QString base = QString());
+
+    /*!
+     * @brief Read snapshot archive
+     *
+     * The file is mapped to memory and payloads of entries point directly to the mapping,
+     * so the file must stay open while the entries are used
+     *
+     * @param file Opened archive file
+     * @param entries Entries read from archive
+     * @param base Base archive relative to this archive if it is delta archive, empty otherwise
+     * @returns false if the file is not valid archive
+     */
+    static bool readArchive(QFile *file, QVector<SnapshotEntry> &entries, QString &base);
+
+    //! Magic bytes of archive header and footer
+    static constexpr const char *archiveMagic = "MQEA";
+
+    //! Version of archive format, version 2 added delta archives
+    static constexpr quint32 archiveVersion = 2;
+
+    //! Size of archive header
+    static constexpr qint64 archiveHeaderSize = 8;
+
+    //! Size of archive index entry
+    static constexpr qint64 archiveIndexEntrySize = 32;
+
+    //! Size of archive footer
+    static constexpr qint64 archiveFooterSize = 32;
+
+    //! Stop the export, entries that are being written are finished
+    void cancel();
+
+    //! This property holds whether the export is running
+    bool isRunning();
+
+signals:
+    /*!
+     * @brief Signal that more entries were written
+     * @param done Number of processed entries
+     * @param total Number of entries
+     */
+    void progress(int done, int total);
+
+    /*!
+     * @brief Signal that export finished
+     * @param written Number of written entries
+     * @param failed Number of entries that could not be written
+     * @param cancelled Whether the export was cancelled
+     */
+    void finished(int written, int failed, bool cancelled);
+
+private slots:
+    //! This slot is called periodically while export is running
+    void onProgressTimeout();
+
+private:
+    /*!
+     * @brief Create job and start workers
+     * @param target Target directory or archive file
+     * @param entries Work list
+     * @param archive Whether single archive file is written
+     * @param base Base of delta archive
+     * @returns false if another export is running
+     */
+    bool startJob(QString target, QVector<SnapshotEntry> entries, bool archive, QString base);
+
+    //! Running export, null when idle
+    std::shared_ptr<SnapshotJob> job;
+
+    //! Pool that runs workers
+    QThreadPool pool;
+
+    //! Timer that reports progress
+    QTimer progressTimer;
+};
+
+#endif
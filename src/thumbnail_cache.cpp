@@ -0,0 +1,181 @@
+/*!
+ * @file thumbnail_cache.cpp
+ * @author Michal Šlesár (xslesa01)
+ * @author Erik Belko (xbelko02)
+ * @brief Implementation of ThumbnailCache and ThumbnailDelegate
+ */
+
+#include "thumbnail_cache.h"
+
+#include <algorithm>
+
+#include <QStyle>
+#include <QBuffer>
+#include <QThread>
+#include <QPainter>
+#include <QApplication>
+#include <QImageReader>
+
+#include "utils.h"
+
+ThumbnailWorker::ThumbnailWorker(ThumbnailCache *cache, quint64 key, QByteArray payload, QSize size) : 
+    cache(cache), key(key), payload(payload), size(size) {}
+
+void ThumbnailWorker::run()
+{
+    QBuffer buffer;
+    buffer.setData(payload);
+    buffer.open(QIODevice::ReadOnly);
+
+    // Scaled size is set before reading, JPEG is then decoded directly at reduced resolution
+    QImageReader reader(&buffer);
+    auto imageSize = reader.size();
+
+    if(imageSize.isValid())
+    {
+        reader.setScaledSize(imageSize.scaled(size, Qt::KeepAspectRatio).expandedTo(QSize(1, 1)));
+        reader.setQuality(0);
+    }
+
+    auto image = reader.read();
+
+    // Formats without scaled decoding are scaled after decoding
+    if(!image.isNull() && (image.width() > size.width() || image.height() > size.height()))
+        image = image.scaled(size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+
+    // Delivered on thread of the cache, dropped if the cache no longer exists
+    QMetaObject::invokeMethod(cache, [cache = cache, key = key, image]() {
+        cache->store(key, image);
+    }, Qt::QueuedConnection);
+}
+
+ThumbnailCache::ThumbnailCache(QObject *parent) : QObject(parent)
+{
+    thumbnails.setMaxCost(maxCost);
+
+    // Leave some cores for GUI and snapshot workers
+    pool.setMaxThreadCount(std::max(1, QThread::idealThreadCount() / 2));
+}
+
+bool ThumbnailCache::find(quint64 key, QImage &image)
+{
+    auto thumbnail = thumbnails.object(key);
+
+    if(thumbnail == Q_NULLPTR)
+        return false;
+
+    image = *thumbnail;
+    return true;
+}
+
+void ThumbnailCache::request(quint64 key, QByteArray payload)
+{
+    if(pending.contains(key) || thumbnails.contains(key))
+        return;
+
+    pending.insert(key);
+    pool.start(new ThumbnailWorker(this, key, payload, QSize(thumbnailWidth, thumbnailHeight)));
+}
+
+void ThumbnailCache::store(quint64 key, QImage image)
+{
+    pending.remove(key);
+
+    // Payloads that are not images are cached too, so they are not decoded again
+    thumbnails.insert(key, new QImage(image), (int) std::max<qsizetype>(1, image.sizeInBytes()));
+
+    emit thumbnailReady(key);
+}
+
+void ThumbnailCache::clear()
+{
+    pool.clear();
+    pool.waitForDone();
+    pending.clear();
+}
+
+ThumbnailCache::~ThumbnailCache()
+{
+    clear();
+}
+
+ThumbnailDelegate::ThumbnailDelegate(ThumbnailCache *cache, int height, QObject *parent) : 
+    QStyledItemDelegate(parent), cache(cache), height(height) {}
+
+void ThumbnailDelegate::initThumbnailOption(QStyleOptionViewItem *option, const QModelIndex &index) const
+{
+    initStyleOption(option, index);
+
+    // Space is reserved even before the thumbnail is decoded, so rows do not change size
+    option->features |= QStyleOptionViewItem::HasDecoration;
+    option->decorationSize = QSize(height * ThumbnailCache::thumbnailWidth / ThumbnailCache::thumbnailHeight, height);
+}
+
+void ThumbnailDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    if(!itemData(index, imageRole).toBool())
+    {
+        QStyledItemDelegate::paint(painter, option, index);
+        return;
+    }
+
+    QStyleOptionViewItem thumbnailOption(option);
+    initThumbnailOption(&thumbnailOption, index);
+
+    auto style = option.widget != Q_NULLPTR ? option.widget->style() : QApplication::style();
+    style->drawControl(QStyle::CE_ItemViewItem, &thumbnailOption, painter, option.widget);
+
+    // Only visible rows request thumbnails
+    auto key = itemData(index, thumbnailRole).toULongLong();
+    QImage image;
+
+    if(!cache->find(key, image))
+    {
+        cache->request(key, itemData(index, payloadRole).toByteArray());
+        return;
+    }
+
+    if(image.isNull())
+        return;
+
+    auto rect = style->subElementRect(QStyle::SE_ItemViewItemDecoration, &thumbnailOption, option.widget);
+    auto size = image.size().scaled(rect.size(), Qt::KeepAspectRatio);
+    auto target = QRect(QPoint(0, 0), size);
+    target.moveCenter(rect.center());
+
+    painter->save();
+    painter->setRenderHint(QPainter::SmoothPixmapTransform);
+    painter->drawImage(target, image);
+    painter->restore();
+}
+
+void ThumbnailDelegate::initStyleOption(QStyleOptionViewItem *option, const QModelIndex &index) const
+{
+    QStyledItemDelegate::initStyleOption(option, index);
+
+    if(!itemData(index, imageRole).toBool())
+        option->text += Utils::previewText(itemData(index, payloadRole).toByteArray(), previewLength);
+}
+
+QVariant ThumbnailDelegate::itemData(const QModelIndex &index, int role) const
+{
+    return index.data(role);
+}
+
+QSize ThumbnailDelegate::sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    auto style = option.widget != Q_NULLPTR ? option.widget->style() : QApplication::style();
+
+    // Preview is elided to the row, so all rows are measured without building it
+    if(!itemData(index, imageRole).toBool())
+    {
+        QStyleOptionViewItem textOption(option);
+        QStyledItemDelegate::initStyleOption(&textOption, index);
+        return style->sizeFromContents(QStyle::CT_ItemViewItem, &textOption, QSize(), option.widget);
+    }
+
+    QStyleOptionViewItem thumbnailOption(option);
+    initThumbnailOption(&thumbnailOption, index);
+
+    return style->sizeFromContents(QStyle::CT_ItemViewItem, &thumbnailOption, QSize(), option.widget);
+}
@@ -0,0 +1,192 @@
+/*!
+ * @file thumbnail_cache.h
+ * @author Michal Šlesár (xslesa01)
+ * @author Erik Belko (xbelko02)
+ * @brief Thumbnails of image messages
+ */
+
+#ifndef E_THUMBNAIL_CACHE_H
+#define E_THUMBNAIL_CACHE_H
+
+#include <QSet>
+#include <QSize>
+#include <QCache>
+#include <QImage>
+#include <QObject>
+#include <QRunnable>
+#include <QByteArray>
+#include <QThreadPool>
+#include <QStyledItemDelegate>
+
+class ThumbnailCache;
+
+//! Decodes one thumbnail on worker thread
+class ThumbnailWorker : public QRunnable
+{
+public:
+    /*!
+     * @brief Constructor
+     * @param cache Cache the thumbnail is delivered to
+     * @param key Thumbnail key
+     * @param payload Raw image
+     * @param size Bounding size of thumbnail
+     */
+    ThumbnailWorker(ThumbnailCache *cache, quint64 key, QByteArray payload, QSize size);
+
+    //! Decode thumbnail
+    void run() override;
+
+private:
+    //! Cache the thumbnail is delivered to
+    ThumbnailCache *cache;
+
+    //! Thumbnail key
+    quint64 key;
+
+    //! Raw image
+    QByteArray payload;
+
+    //! Bounding size of thumbnail
+    QSize size;
+};
+
+/*!
+ * @brief Bounded cache of image thumbnails
+ *
+ * Thumbnails are keyed by payload hash, so the same image shared by more messages is decoded once.
+ * Missing thumbnails are decoded on thread pool, QImageReader scales JPEG images while decoding,
+ * so full frames are never decoded.
+ */
+class ThumbnailCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    /*!
+     * @brief Constructor
+     * @param parent Parent object
+     */
+    ThumbnailCache(QObject *parent);
+
+    //! Destructor, waits for running workers
+    ~ThumbnailCache();
+
+    /*!
+     * @brief Find thumbnail
+     * @param key Thumbnail key
+     * @param image Thumbnail, null image if the payload could not be decoded
+     * @returns false if the thumbnail was not decoded yet
+     */
+    bool find(quint64 key, QImage &image);
+
+    /*!
+     * @brief Decode thumbnail in background unless it is cached or already being decoded
+     * @param key Thumbnail key
+     * @param payload Raw image
+     */
+    void request(quint64 key, QByteArray payload);
+
+    //! Drop queued workers and wait for running ones, so payloads they reference can be released
+    void clear();
+
+    //! Bounding width of thumbnails
+    static constexpr int thumbnailWidth = 96;
+
+    //! Bounding height of thumbnails
+    static constexpr int thumbnailHeight = 64;
+
+    //! How many bytes thumbnails can use
+    static constexpr int maxCost = 16 * 1024 * 1024;
+
+signals:
+    /*!
+     * @brief Signal that thumbnail was decoded
+     * @param key Thumbnail key
+     */
+    void thumbnailReady(quint64 key);
+
+private:
+    friend class ThumbnailWorker;
+
+    /*!
+     * @brief Store decoded thumbnail, called on thread of the cache
+     * @param key Thumbnail key
+     * @param image Thumbnail
+     */
+    void store(quint64 key, QImage image);
+
+    //! Decoded thumbnails
+    QCache<quint64, QImage> thumbnails;
+
+    //! Keys being decoded
+    QSet<quint64> pending;
+
+    //! Pool that runs workers
+    QThreadPool pool;
+};
+
+/*!
+ * @brief Draws thumbnail in front of item text for image messages and preview of text messages
+ *
+ * Item holds raw payload in payloadRole, whether it is image in imageRole and payload hash in thumbnailRole.
+ * Preview of text payload is appended to item text only when the row is painted, rows are measured without it.
+ */
+class ThumbnailDelegate : public QStyledItemDelegate
+{
+    Q_OBJECT
+
+public:
+    /*!
+     * @brief Constructor
+     * @param cache Thumbnail cache
+     * @param height Height of drawn thumbnails
+     * @param parent Parent object
+     */
+    ThumbnailDelegate(ThumbnailCache *cache, int height, QObject *parent);
+
+    //! Draw item with thumbnail
+    void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+
+    //! Image items are tall enough for thumbnail
+    QSize sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+
+    //! Maximum number of characters of text preview
+    static constexpr int previewLength = 256;
+
+    //! Role holding raw payload
+    static constexpr int payloadRole = Qt::UserRole;
+
+    //! Role holding whether the payload is image
+    static constexpr int imageRole = Qt::UserRole + 1;
+
+    //! Role holding thumbnail key
+    static constexpr int thumbnailRole = Qt::UserRole + 3;
+
+protected:
+    //! Append preview of text payload to item text
+    void initStyleOption(QStyleOptionViewItem *option, const QModelIndex &index) const override;
+
+    /*!
+     * @brief Read payload, image flag or thumbnail key of item
+     * @param index Model index
+     * @param role One of the roles of this delegate
+     * @returns data of the model, subclasses may provide it from elsewhere
+     */
+    virtual QVariant itemData(const QModelIndex &index, int role) const;
+
+private:
+    /*!
+     * @brief Prepare style option of image item, space for thumbnail is reserved as decoration
+     * @param option Style option
+     * @param index Model index
+     */
+    void initThumbnailOption(QStyleOptionViewItem *option, const QModelIndex &index) const;
+
+    //! Thumbnail cache
+    ThumbnailCache *cache;
+
+    //! Height of drawn thumbnails
+    int height;
+};
+
+#endif
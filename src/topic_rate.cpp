@@ -0,0 +1,69 @@
+/*!
+ * @file topic_rate.cpp
+ * @author Michal Šlesár (xslesa01)
+ * @author Erik Belko (xbelko02)
+ * @brief Implementation of TopicRate
+ */
+
+#include "topic_rate.h"
+
+#include <cmath>
+
+void RateCounter::add(double amount, qint64 now)
+{
+    value = valueAt(now) + amount;
+    time = now;
+}
+
+void RateCounter::add(const RateCounter &counter, qint64 now)
+{
+    add(counter.valueAt(now), now);
+}
+
+double RateCounter::rate(qint64 now) const
+{
+    return valueAt(now) * 1000 / timeConstant;
+}
+
+void RateCounter::reset()
+{
+    value = 0;
+}
+
+double RateCounter::valueAt(qint64 now) const
+{
+    if(value == 0 || now <= time)
+        return value;
+
+    return value * std::exp((time - now) / timeConstant);
+}
+
+bool TopicRate::record(qint64 bytes, qint64 now)
+{
+    messages.add(1, now);
+    this->bytes.add(bytes, now);
+    pendingMessages.add(1, now);
+    pendingBytes.add(bytes, now);
+
+    if(pending)
+        return false;
+
+    pending = true;
+    return true;
+}
+
+void TopicRate::rollUp(qint64 now)
+{
+    if(!pending)
+        return;
+
+    for(auto rate = this; rate != Q_NULLPTR; rate = rate->parent)
+    {
+        rate->subtreeMessages.add(pendingMessages, now);
+        rate->subtreeBytes.add(pendingBytes, now);
+    }
+
+    pendingMessages.reset();
+    pendingBytes.reset();
+    pending = false;
+}
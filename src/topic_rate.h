@@ -0,0 +1,114 @@
+/*!
+ * @file topic_rate.h
+ * @author Michal Šlesár (xslesa01)
+ * @author Erik Belko (xbelko02)
+ * @brief Message and byte rates of topics
+ */
+
+#ifndef E_TOPIC_RATE_H
+#define E_TOPIC_RATE_H
+
+#include <QtGlobal>
+
+/*!
+ * @brief Exponentially decaying counter
+ *
+ * Value decays continuously with time constant, it is brought to the current time only when it is
+ * added to or read, so idle counters cost nothing. Counters with the same time constant can be summed.
+ */
+class RateCounter
+{
+public:
+    /*!
+     * @brief Add amount at given time
+     * @param amount Amount, e.g. number of messages or bytes
+     * @param now Current time in milliseconds
+     */
+    void add(double amount, qint64 now);
+
+    /*!
+     * @brief Add value of another counter
+     * @param counter Counter
+     * @param now Current time in milliseconds
+     */
+    void add(const RateCounter &counter, qint64 now);
+
+    /*!
+     * @brief Rate per second
+     * @param now Current time in milliseconds
+     * @returns amount per second averaged over the time constant
+     */
+    double rate(qint64 now) const;
+
+    //! Set the counter to zero
+    void reset();
+
+    //! Time constant in milliseconds
+    static constexpr double timeConstant = 5000;
+
+private:
+    /*!
+     * @brief Value decayed to given time
+     * @param now Current time in milliseconds
+     * @returns decayed value
+     */
+    double valueAt(qint64 now) const;
+
+    //! Value at time of the last update
+    double value = 0;
+
+    //! Time of the last update in milliseconds
+    qint64 time = 0;
+};
+
+/*!
+ * @brief Message and byte rates of one topic and its subtree
+ *
+ * Messages are recorded only to the topic itself, they are also collected in pending counters.
+ * Pending counters are added to subtree counters of the topic and all its ancestors by rollUp,
+ * so noisy topic costs one walk to the root per roll up, not per message.
+ */
+class TopicRate
+{
+public:
+    /*!
+     * @brief Record received message
+     * @param bytes Payload size
+     * @param now Current time in milliseconds
+     * @returns true if the topic was not pending yet and has to be rolled up
+     */
+    bool record(qint64 bytes, qint64 now);
+
+    /*!
+     * @brief Add pending counters to subtree counters of the topic and its ancestors
+     * @param now Current time in milliseconds
+     */
+    void rollUp(qint64 now);
+
+    //! Messages of the topic alone
+    RateCounter messages;
+
+    //! Bytes of the topic alone
+    RateCounter bytes;
+
+    //! Messages of the topic and all its descendants, current as of the last roll up
+    RateCounter subtreeMessages;
+
+    //! Bytes of the topic and all its descendants, current as of the last roll up
+    RateCounter subtreeBytes;
+
+    //! Rates of parent topic, null for top level topics
+    TopicRate *parent = Q_NULLPTR;
+
+private:
+    //! Messages recorded since the last roll up
+    RateCounter pendingMessages;
+
+    //! Bytes recorded since the last roll up
+    RateCounter pendingBytes;
+
+    //! Whether there is anything to roll up
+    bool pending = false;
+};
+
+#endif
@@ -7,13 +7,22 @@
 
 #include "utils.h"
 
+#include <algorithm>
+
 #include <QFile>
+#include <QBuffer>
 #include <QDialog>
 #include <QPixmap>
 #include <QString>
 #include <QWidget>
+#include <QVariant>
 #include <QByteArray>
 #include <QFileDialog>
+#include <QImageReader>
+#include <QRadioButton>
+#include <QStringList>
+
+#include "payload_viewer.h"
 
 #include "ui_preview_image.h"
 #include "ui_preview_string.h"
@@ -62,11 +71,25 @@ void Utils::openImage(QPixmap image, QWidget *parent)
 }
 
 void Utils::openText(QString text, QWidget *parent)
+{
+    openPayload(text.toUtf8(), parent);
+}
+
+void Utils::openPayload(QByteArray payload, QWidget *parent)
 {
     auto dialog = new QDialog(parent);
     Ui_PreviewString preview;
     preview.setupUi(dialog);
-    preview.textBrowser->setText(text);
+
+    // Viewer shares the payload and formats only visible rows
+    preview.viewer->setPayload(payload);
+    preview.radioHex->setChecked(preview.viewer->getMode() == PayloadViewer::Hex);
+    preview.labelSize->setText(formatBytes(payload.size()));
+
+    QObject::connect(preview.radioHex, &QRadioButton::toggled, [&](bool checked) {
+        preview.viewer->setMode(checked ? PayloadViewer::Hex : PayloadViewer::Text);
+    });
+
     dialog->exec();
     delete dialog;
 }
@@ -75,4 +98,90 @@ void Utils::centerWidget(QWidget *widget, QWidget *parent)
 {
     auto geometry = parent->geometry();
     widget->move(geometry.center() - widget->rect().center());
-}
\ No newline at end of file
+}
+
+bool Utils::isImage(const QByteArray &data)
+{
+    // Only binary type that is supported is image, it is recognized by header without decoding,
+    // so this is cheap and safe on any thread, text formats (e.g. "P1 ...") must also have valid size
+    QBuffer buffer;
+    buffer.setData(data);
+    buffer.open(QIODevice::ReadOnly);
+
+    QImageReader reader(&buffer);
+    return reader.canRead() && reader.size().isValid();
+}
+
+QString Utils::formatBytes(qint64 bytes)
+{
+    if(bytes < 1024)
+        return QString("%1 B").arg(bytes);
+
+    auto units = QStringList() << "KiB" << "MiB" << "GiB" << "TiB";
+    auto value = bytes / 1024.0;
+    auto unit = 0;
+
+    while(value >= 1024 && unit < units.count() - 1)
+    {
+        value /= 1024;
+        unit++;
+    }
+
+    return QString("%1 %2").arg(value, 0, 'f', 1).arg(units[unit]);
+}
+
+quint64 Utils::hashPayload(const QByteArray &data)
+{
+    quint64 hash = 14695981039346656037ULL;
+    auto bytes = reinterpret_cast<const uchar*>(data.constData());
+
+    for(auto i = 0; i < data.size(); i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+QString Utils::previewText(const QByteArray &payload, int length)
+{
+    // UTF-8 character has at most 4 bytes, prefix is cut at character boundary
+    auto in = reinterpret_cast<const uchar*>(payload.constData());
+    auto end = std::min(payload.size(), length * 4);
+    while(end > 0 && end < payload.size() && (in[end] & 0xC0) == 0x80)
+        end--;
+
+    // Branchless scan the compiler can vectorize, most texts need no collapsing at all
+    uchar collapse = end > 0 && (in[0] == ' ' || in[end - 1] == ' ');
+    for(auto i = 0; i < end; i++)
+        collapse |= (uchar) (in[i] - '\t') < 5;
+    for(auto i = 1; i < end; i++)
+        collapse |= (in[i] == ' ') & (in[i - 1] == ' ');
+
+    if(!collapse)
+        return QString::fromUtf8(payload.constData(), end).left(length);
+
+    // UTF-8 continuation bytes are never ASCII whitespace, so bytes can be collapsed before decoding
+    QByteArray prefix(end, Qt::Uninitialized);
+    auto out = prefix.data();
+    auto size = 0;
+    auto space = true;
+
+    for(auto i = 0; i < end; i++)
+    {
+        auto isSpace = in[i] == ' ' || (uchar) (in[i] - '\t') < 5;
+
+        if(!isSpace)
+            out[size++] = in[i];
+        else if(!space)
+            out[size++] = ' ';
+
+        space = isSpace;
+    }
+
+    if(size > 0 && out[size - 1] == ' ')
+        size--;
+
+    return QString::fromUtf8(out, size).left(length);
+}
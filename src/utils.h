@@ -11,6 +11,7 @@
 #include <QPixmap>
 #include <QWidget>
 #include <QString>
+#include <QVariant>
 #include <QByteArray>
 
 /*!
@@ -69,6 +70,13 @@ public:
      */
     static void openText(QString text, QWidget *parent);
 
+    /*!
+     * @brief Open payload in new window as text or hex dump
+     * @param payload Payload
+     * @param parent Parent widget of the created window
+     */
+    static void openPayload(QByteArray payload, QWidget *parent);
+
     /*!
      * @brief Center widget relative to another widget
      * @param widget Widget to be centered
@@ -76,6 +84,37 @@ public:
      * @returns
      */
     static void centerWidget(QWidget *widget, QWidget *parent);
+
+    /*!
+     * @brief Classify payload as image or text
+     *
+     * Image is recognized by its header only, it is decoded later by whoever shows it.
+     * @param data Byte array
+     * @returns true if the payload is image
+     */
+    static bool isImage(const QByteArray &data);
+
+    /*!
+     * @brief Format number of bytes with binary unit
+     * @param bytes Number of bytes
+     * @returns text, e.g. "1.5 MiB"
+     */
+    static QString formatBytes(qint64 bytes);
+
+    /*!
+     * @brief Compute 64-bit FNV-1a hash of payload, stable between runs of the application
+     * @param data Byte array
+     * @returns hash
+     */
+    static quint64 hashPayload(const QByteArray &data);
+
+    /*!
+     * @brief Create one line preview of text payload from its beginning, whitespace is collapsed like QString::simplified
+     * @param payload UTF-8 payload
+     * @param length Maximum number of characters
+     * @returns preview text
+     */
+    static QString previewText(const QByteArray &payload, int length);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,297 @@
+/*!
+ * @file chart.cpp
+ * @author Michal Šlesár (xslesa01)
+ * @author Erik Belko (xbelko02)
+ * @brief WidgetChart implementation
+ */
+
+#include "chart.h"
+
+#include <algorithm>
+
+#include <QTimer>
+#include <QString>
+#include <QPainter>
+#include <QPolygonF>
+#include <QDateTime>
+#include <QPushButton>
+#include <QJsonObject>
+
+#include "../../utils.h"
+#include "../../explorer.h"
+
+#include "ui_chart_settings.h"
+
+SampleBuffer::SampleBuffer(int capacity) : times(capacity), values(capacity) {}
+
+void SampleBuffer::append(qint64 time, float value)
+{
+    times[head] = time;
+    values[head] = value;
+
+    head = (head + 1) % times.count();
+    size = std::min(size + 1, times.count());
+}
+
+int SampleBuffer::count() const
+{
+    return size;
+}
+
+qint64 SampleBuffer::timeAt(int i) const
+{
+    return times[(head - size + i + times.count()) % times.count()];
+}
+
+float SampleBuffer::valueAt(int i) const
+{
+    return values[(head - size + i + values.count()) % values.count()];
+}
+
+ChartView::ChartView(qint64 window, int capacity, QWidget *parent) : QWidget(parent), samples(capacity), window(window)
+{
+    setMinimumSize(300, 120);
+    connect(&clock, &QTimer::timeout, this, QOverload<>::of(&ChartView::update));
+}
+
+void ChartView::append(qint64 time, float value)
+{
+    samples.append(time, value);
+    addToBucket(time, value);
+
+    // Repaints are merged, so fast topic costs at most one drawing per frame
+    update();
+}
+
+void ChartView::addToBucket(qint64 time, float value)
+{
+    auto index = time / bucketDuration;
+
+    // Sample with older timestamp than the last one (e.g. clock change) joins the last bucket
+    if(buckets.empty() || buckets.back().index < index)
+        buckets.push_back({ index, value, value, value, value });
+    else
+    {
+        auto &bucket = buckets.back();
+        bucket.last = value;
+        bucket.min = std::min(bucket.min, value);
+        bucket.max = std::max(bucket.max, value);
+    }
+
+    while(buckets.front().index <= buckets.back().index - bucketCount)
+        buckets.pop_front();
+}
+
+void ChartView::rebuildBuckets()
+{
+    bucketCount = std::max(1, width());
+    bucketDuration = std::max<qint64>(1, window / bucketCount);
+
+    buckets.clear();
+    for(auto i = 0; i < samples.count(); i++)
+        addToBucket(samples.timeAt(i), samples.valueAt(i));
+
+    // Chart moves by one column per bucket
+    clock.setInterval((int) std::max<qint64>(bucketDuration, 16));
+}
+
+void ChartView::updateClock()
+{
+    if(isVisible() && !offscreen)
+    {
+        if(!clock.isActive())
+            clock.start();
+    }
+    else
+        clock.stop();
+}
+
+void ChartView::setOffscreen(bool offscreen)
+{
+    this->offscreen = offscreen;
+    updateClock();
+}
+
+void ChartView::resizeEvent(QResizeEvent *event)
+{
+    QWidget::resizeEvent(event);
+    rebuildBuckets();
+}
+
+void ChartView::showEvent(QShowEvent *event)
+{
+    QWidget::showEvent(event);
+    updateClock();
+}
+
+void ChartView::hideEvent(QHideEvent *event)
+{
+    QWidget::hideEvent(event);
+    updateClock();
+}
+
+void ChartView::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event);
+
+    QPainter painter(this);
+    painter.fillRect(rect(), Qt::white);
+    painter.setPen(Qt::gray);
+    painter.drawRect(rect().adjusted(0, 0, -1, -1));
+
+    // Chart ends at current time, clock repaints it even when messages stop
+    auto now = QDateTime::currentMSecsSinceEpoch() / bucketDuration;
+    auto first = std::find_if(buckets.begin(), buckets.end(), [&](const SampleBucket &bucket) {
+        return bucket.index > now - bucketCount;
+    });
+
+    if(first == buckets.end())
+    {
+        painter.drawText(rect(), Qt::AlignCenter, "No data");
+        return;
+    }
+
+    auto low = first->min;
+    auto high = first->max;
+    for(auto it = first; it != buckets.end(); ++it)
+    {
+        low = std::min(low, it->min);
+        high = std::max(high, it->max);
+    }
+
+    auto height = this->height() - 1;
+    auto range = high > low ? high - low : 1.0f;
+    auto y = [&](float value) {
+        return high > low ? height - (value - low) / range * height : height / 2.0;
+    };
+
+    // Each column is drawn as vertical line between its extremes, joined through first and last values
+    QPolygonF line;
+    for(auto it = first; it != buckets.end(); ++it)
+    {
+        auto x = width() - 1 - (now - it->index);
+
+        line << QPointF(x, y(it->first)) << QPointF(x, y(it->min)) << QPointF(x, y(it->max)) << QPointF(x, y(it->last));
+    }
+
+    painter.setPen(Qt::blue);
+    painter.drawPolyline(line);
+
+    painter.setPen(Qt::black);
+    painter.drawText(rect().adjusted(4, 2, -4, -2), Qt::AlignTop | Qt::AlignLeft, QString::number(high));
+    painter.drawText(rect().adjusted(4, 2, -4, -2), Qt::AlignBottom | Qt::AlignLeft, QString::number(low));
+}
+
+WidgetChart::WidgetChart(Explorer* explorer) : Widget(explorer) {}
+
+void WidgetChart::offscreenChanged()
+{
+    if(view != Q_NULLPTR)
+        view->setOffscreen(offscreen);
+}
+
+void WidgetChart::onRemoveButtonClicked()
+{
+    explorer->removeWidget(this);
+}
+
+bool WidgetChart::Setup(QJsonObject data)
+{
+    name = data.value("name").toString();
+    topic = data.value("topic").toString();
+    field = data.value("field").toString();
+    window = std::clamp(data.value("window").toInt(60), 1, maxWindow);
+    return fieldPath.compile(field);
+}
+
+bool WidgetChart::Setup()
+{
+    auto dialog = new QDialog(explorer);
+    Ui_ChartWidgetSettings settings;
+    settings.setupUi(dialog);
+    Utils::centerWidget(dialog, explorer);
+    auto result = dialog->exec();
+
+    topic = settings.topic->text();
+    name = settings.name->text();
+    field = settings.field->text();
+    window = settings.window->value();
+
+    delete dialog;
+
+    // Path is compiled once, messages are only scanned for the field
+    if(result && !fieldPath.compile(field))
+    {
+        explorer->setStatus("Invalid JSON field");
+        return false;
+    }
+
+    return result;
+}
+
+QJsonObject WidgetChart::ExtractConfig()
+{
+    QJsonObject result;
+    result.insert("widget", "Chart");
+    result.insert("name", name);
+    result.insert("topic", topic);
+    result.insert("field", field);
+    result.insert("window", window);
+    return result;
+}
+
+void WidgetChart::messageReceived(QString topic, QByteArray payload, bool isImage, [[maybe_unused]] bool local)
+{
+    QByteArray value;
+    if(this->topic != topic || isImage || view == Q_NULLPTR || !fieldPath.find(payload, value))
+        return;
+
+    bool isNumber;
+    auto number = value.trimmed().toFloat(&isNumber);
+
+    if(!isNumber)
+        return;
+
+    view->append(QDateTime::currentMSecsSinceEpoch(), number);
+    labelValue->setText(QString::number(number));
+}
+
+bool WidgetChart::Render()
+{
+    auto result = explorer->subscribeTopic(topic);
+
+    if(result == 1)
+    {
+        explorer->setStatus("Wildcard is not supported");
+        return false;
+    }
+    else if(result == 2)
+    {
+        explorer->setStatus("Invalid topic format");
+        return false;
+    }
+    
+    if(name.isEmpty())
+    {
+        explorer->setStatus("Widget name can not be empty");
+        return false;
+    }
+
+    if(window <= 0)
+    {
+        explorer->setStatus("Chart window must be positive");
+        return false;
+    }
+
+    setupUi(this);
+
+    labelName->setText(name);
+
+    // Buffer holds the whole window at the highest expected rate
+    view = new ChartView((qint64) window * 60 * 1000, window * 60 * maxRate, this);
+    view->setOffscreen(offscreen);
+    layoutChart->addWidget(view);
+
+    connect(buttonRemove, &QPushButton::clicked, this, &WidgetChart::onRemoveButtonClicked);
+    return true;
+}
@@ -0,0 +1,268 @@
+/*!
+ * @file chart.h
+ * @author Michal Šlesár (xslesa01)
+ * @author Erik Belko (xbelko02)
+ * @brief Numeric time series chart widget
+ */
+
+#ifndef E_WIDGET_CHART_H
+#define E_WIDGET_CHART_H
+
+#include <deque>
+
+#include <QTimer>
+#include <QWidget>
+#include <QString>
+#include <QVector>
+#include <QVariant>
+#include <QJsonObject>
+
+#include "../widget.h"
+#include "../../json_path.h"
+
+#include "../../explorer.h"
+
+#include "ui_chart.h"
+
+// Forward declarations
+class Explorer;
+
+/*!
+ * @brief Ring buffer of samples with fixed capacity
+ *
+ * Timestamps and values are stored in separate arrays, once the buffer is full the oldest samples are overwritten.
+ */
+class SampleBuffer
+{
+public:
+    /*!
+     * @brief Constructor
+     * @param capacity Maximum number of samples
+     */
+    SampleBuffer(int capacity);
+
+    /*!
+     * @brief Append sample, timestamps must not decrease
+     * @param time Timestamp in milliseconds since epoch
+     * @param value Value
+     */
+    void append(qint64 time, float value);
+
+    //! Number of stored samples
+    int count() const;
+
+    /*!
+     * @brief Timestamp of sample
+     * @param i Index of sample, 0 is the oldest
+     * @returns timestamp in milliseconds since epoch
+     */
+    qint64 timeAt(int i) const;
+
+    /*!
+     * @brief Value of sample
+     * @param i Index of sample, 0 is the oldest
+     * @returns value
+     */
+    float valueAt(int i) const;
+
+private:
+    //! Timestamps of samples
+    QVector<qint64> times;
+
+    //! Values of samples
+    QVector<float> values;
+
+    //! Position the next sample is written to
+    int head = 0;
+
+    //! Number of stored samples
+    int size = 0;
+};
+
+//! Samples that fall into one pixel column of chart
+class SampleBucket
+{
+public:
+    //! Timestamp divided by bucket duration
+    qint64 index;
+
+    //! Value of the first sample
+    float first;
+
+    //! Value of the last sample
+    float last;
+
+    //! Smallest value
+    float min;
+
+    //! Largest value
+    float max;
+};
+
+/*!
+ * @brief Plot of samples downsampled to pixel columns
+ *
+ * Every pixel column keeps first, last, minimum and maximum of its samples, so spikes stay visible.
+ * Columns are updated as samples arrive and rebuilt from the buffer only when width changes,
+ * drawing cost depends on width, not on number of samples.
+ */
+class ChartView : public QWidget
+{
+    Q_OBJECT
+
+public:
+    /*!
+     * @brief Constructor
+     * @param window Shown time window in milliseconds
+     * @param capacity Maximum number of stored samples
+     * @param parent Parent widget
+     */
+    ChartView(qint64 window, int capacity, QWidget *parent);
+
+    /*!
+     * @brief Add sample
+     * @param time Timestamp in milliseconds since epoch
+     * @param value Value
+     */
+    void append(qint64 time, float value);
+
+    /*!
+     * @brief Set whether chart is scrolled out of dashboard view
+     * @param offscreen Whether chart is out of view, it does not move with time then
+     */
+    void setOffscreen(bool offscreen);
+
+protected:
+    //! Draw chart
+    void paintEvent(QPaintEvent *event) override;
+
+    //! Rebuild buckets for new width
+    void resizeEvent(QResizeEvent *event) override;
+
+    //! Start moving chart with time
+    void showEvent(QShowEvent *event) override;
+
+    //! Stop moving chart with time
+    void hideEvent(QHideEvent *event) override;
+
+private:
+    /*!
+     * @brief Add sample to its bucket, buckets outside of window are dropped
+     * @param time Timestamp in milliseconds since epoch
+     * @param value Value
+     */
+    void addToBucket(qint64 time, float value);
+
+    //! Rebuild all buckets from stored samples
+    void rebuildBuckets();
+
+    //! Run clock only while chart is shown and in view
+    void updateClock();
+
+    //! Stored samples
+    SampleBuffer samples;
+
+    //! Buckets from the oldest
+    std::deque<SampleBucket> buckets;
+
+    //! Shown time window in milliseconds
+    qint64 window;
+
+    //! Time covered by one bucket in milliseconds
+    qint64 bucketDuration = 1;
+
+    //! Number of buckets that fit into width
+    int bucketCount = 1;
+
+    //! Repaints chart once per bucket, so it moves on even when messages stop
+    QTimer clock;
+
+    //! Whether chart is scrolled out of dashboard view
+    bool offscreen = false;
+};
+
+/*! 
+ * @brief Chart of numeric values of topic
+ * 
+ * This widget listens on provided topic, accepts all number messages and plots them over configured time window
+ */
+class WidgetChart : public Widget, public Ui::ChartWidget
+{
+    Q_OBJECT
+
+public:
+    /*!
+     * @brief Constructor
+     * @param explorer Explorer instance
+     */
+    WidgetChart(Explorer* explorer);
+
+    /*!
+     * @brief Setup widget when added to dashboard
+     * @returns true if successful, false otherwise
+     */
+    virtual bool Setup() override;
+
+    /*!
+     * @brief Setup widget when loaded from configuration file
+     * @param data JSON object loaded from file
+     * @returns true if successful, false otherwise
+     */
+    virtual bool Setup(QJsonObject data) override;
+
+    /*!
+     * @brief Render widget to dashboard
+     * @returns true if successful, false otherwise
+     */
+    virtual bool Render() override;
+
+    /*!
+     * @brief Return config created by widget so it can be saved to configuration file
+     * @returns Config in JSON format
+     */
+    virtual QJsonObject ExtractConfig() override;
+
+    //! Highest expected message rate, it determines capacity of sample buffer
+    static constexpr int maxRate = 10;
+
+    //! Longest time window in minutes, the same as in settings dialog
+    static constexpr int maxWindow = 1440;
+
+protected:
+    //! Chart stops moving with time while it is out of view
+    virtual void offscreenChanged() override;
+
+private slots:
+    //! This slot is called when remove button is clicked
+    void onRemoveButtonClicked();
+
+    /*!
+     * @brief This slot is called when client receives new message
+     * @param topic Topic
+     * @param payload Raw payload
+     * @param isImage Whether the payload is image
+     * @param local Whether the message was sent from us
+     */
+    virtual void messageReceived(QString topic, QByteArray payload, bool isImage, bool local) override;
+
+private:
+    //! Widget name
+    QString name;
+
+    //! Topic name
+    QString topic;
+
+    //! JSON path of the shown field, empty for the whole payload
+    QString field;
+
+    //! Compiled JSON path of the shown field
+    JsonPath fieldPath;
+
+    //! Shown time window in minutes
+    int window = 60;
+
+    //! Plot
+    ChartView *view = Q_NULLPTR;
+};
+
+#endif
@@ -33,7 +33,8 @@ bool WidgetLcdDisplay::Setup(QJsonObject data)
 {
     name = data.value("name").toString();
     topic = data.value("topic").toString();
-    return true;
+    field = data.value("field").toString();
+    return fieldPath.compile(field);
 }
 
 bool WidgetLcdDisplay::Setup()
@@ -46,8 +47,17 @@ bool WidgetLcdDisplay::Setup()
 
     topic = settings.topic->text();
     name = settings.name->text();
+    field = settings.field->text();
 
     delete dialog;
+
+    // Path is compiled once, messages are only scanned for the field
+    if(result && !fieldPath.compile(field))
+    {
+        explorer->setStatus("Invalid JSON field");
+        return false;
+    }
+
     return result;
 }
 
@@ -57,15 +67,17 @@ QJsonObject WidgetLcdDisplay::ExtractConfig()
     result.insert("widget", "LcdDisplay");
     result.insert("name", name);
     result.insert("topic", topic);
+    result.insert("field", field);
     return result;
 }
 
-void WidgetLcdDisplay::messageReceived(QString topic, QVariant data, [[maybe_unused]] bool local)
+void WidgetLcdDisplay::messageReceived(QString topic, QByteArray payload, bool isImage, [[maybe_unused]] bool local)
 {
-    if(this->topic != topic || data.userType() != QMetaType::QString)
+    QByteArray value;
+    if(this->topic != topic || isImage || !fieldPath.find(payload, value))
         return;
 
-    auto string = qvariant_cast<QString>(data);
+    auto string = QString::fromUtf8(value);
 
     labelScreenText->setText(string);
     labelLastUpdated->setText(QDateTime::currentDateTime().toString("HH:mm:ss"));
@@ -63,15 +63,13 @@ QJsonObject WidgetLightSwitch::ExtractConfig()
     return result;
 }
 
-void WidgetLightSwitch::messageReceived(QString topic, QVariant data, [[maybe_unused]] bool local)
+void WidgetLightSwitch::messageReceived(QString topic, QByteArray payload, bool isImage, [[maybe_unused]] bool local)
 {
-    if(this->topic != topic || data.userType() != QMetaType::QString)
+    // Only the two states are accepted, so the payload is compared without decoding it
+    if(this->topic != topic || isImage || (payload != "on" && payload != "off"))
         return;
 
-    auto string = qvariant_cast<QString>(data);
-
-    if(string != "on" && string != "off")
-        return;
+    auto string = QString::fromLatin1(payload);
 
     labelStatus->setText(string);
     labelDate->setText(QDateTime::currentDateTime().toString("HH:mm:ss"));
@@ -73,10 +73,11 @@ private slots:
     /*!
      * @brief This slot is called when client receives new message
      * @param topic Topic
-     * @param data Image or string
+     * @param payload Raw payload
+     * @param isImage Whether the payload is image
      * @param local Whether the message was sent from us
      */
-    virtual void messageReceived(QString topic, QVariant data, bool local) override;
+    virtual void messageReceived(QString topic, QByteArray payload, bool isImage, bool local) override;
 
 private:
     //! Widget name
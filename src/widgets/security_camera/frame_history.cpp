@@ -0,0 +1,158 @@
+/*!
+ * @file frame_history.cpp
+ * @author Michal Šlesár (xslesa01)
+ * @author Erik Belko (xbelko02)
+ * @brief Implementation of FrameHistory and FramePrefetcher
+ */
+
+#include "frame_history.h"
+
+#include <algorithm>
+
+void FrameHistory::setWindow(qint64 window)
+{
+    this->window = window;
+}
+
+void FrameHistory::append(qint64 time, QByteArray payload)
+{
+    // Frame with older timestamp than the last one (e.g. clock change) keeps history ordered
+    if(!frames.empty())
+        time = std::max(time, frames.back().time);
+
+    frames.push_back({ nextId++, time, payload });
+    bytes += payload.size();
+
+    while(frames.size() > 1 && (frames.front().time < time - window || bytes > maxBytes))
+    {
+        bytes -= frames.front().payload.size();
+        frames.pop_front();
+    }
+}
+
+int FrameHistory::count() const
+{
+    return (int) frames.size();
+}
+
+const HistoryFrame &FrameHistory::at(int i) const
+{
+    return frames[i];
+}
+
+int FrameHistory::indexAt(qint64 time) const
+{
+    auto it = std::upper_bound(frames.begin(), frames.end(), time, [](qint64 time, const HistoryFrame &frame) {
+        return time < frame.time;
+    });
+
+    return std::max(0, (int) (it - frames.begin()) - 1);
+}
+
+qint64 FrameHistory::size() const
+{
+    return bytes;
+}
+
+FramePrefetcher::FramePrefetcher(FramePool *pool, QObject *parent) : QObject(parent), pool(pool)
+{
+    workers.setMaxThreadCount(1);
+}
+
+FramePrefetcher::~FramePrefetcher()
+{
+    workers.clear();
+    workers.waitForDone();
+}
+
+void FramePrefetcher::request(QVector<HistoryFrame> frames, QSize size)
+{
+    wanted = frames;
+
+    // Frames decoded for another size are decoded again
+    if(size != targetSize)
+    {
+        targetSize = size;
+        for(auto &image : decoded)
+            pool->release(image);
+
+        decoded.clear();
+    }
+
+    for(auto it = decoded.begin(); it != decoded.end();)
+    {
+        if(isWanted(it.key()))
+        {
+            it++;
+            continue;
+        }
+
+        pool->release(it.value());
+        it = decoded.erase(it);
+    }
+
+    if(!busy)
+        start();
+}
+
+bool FramePrefetcher::take(quint64 id, QImage &image)
+{
+    auto it = decoded.find(id);
+    if(it == decoded.end())
+        return false;
+
+    image = it.value();
+    decoded.erase(it);
+    return true;
+}
+
+void FramePrefetcher::clear()
+{
+    wanted.clear();
+
+    for(auto &image : decoded)
+        pool->release(image);
+
+    decoded.clear();
+}
+
+void FramePrefetcher::start()
+{
+    for(auto &frame : wanted)
+    {
+        if(decoded.contains(frame.id))
+            continue;
+
+        auto id = frame.id;
+        busy = true;
+        workers.start(new FrameWorker(pool, frame.payload, targetSize, this, [this, id](QImage image) {
+            finish(id, image);
+        }));
+        return;
+    }
+}
+
+void FramePrefetcher::finish(quint64 id, QImage image)
+{
+    busy = false;
+
+    // Playback may have moved on while the frame was decoded
+    if(isWanted(id))
+    {
+        decoded.insert(id, image);
+        emit frameReady(id);
+    }
+    else
+        pool->release(image);
+
+    start();
+}
+
+bool FramePrefetcher::isWanted(quint64 id)
+{
+    for(auto &frame : wanted)
+        if(frame.id == id)
+            return true;
+
+    return false;
+}
@@ -0,0 +1,178 @@
+/*!
+ * @file frame_history.h
+ * @author Michal Šlesár (xslesa01)
+ * @author Erik Belko (xbelko02)
+ * @brief Compressed history of camera frames
+ */
+
+#ifndef E_FRAME_HISTORY_H
+#define E_FRAME_HISTORY_H
+
+#include <deque>
+
+#include <QMap>
+#include <QSize>
+#include <QImage>
+#include <QVector>
+#include <QObject>
+#include <QByteArray>
+#include <QThreadPool>
+
+#include "frame_pipeline.h"
+
+//! Compressed frame in history
+class HistoryFrame
+{
+public:
+    //! Frame id, increasing by one for every frame
+    quint64 id = 0;
+
+    //! Time the frame was received (in milliseconds since epoch)
+    qint64 time = 0;
+
+    //! Original compressed payload
+    QByteArray payload;
+};
+
+/*!
+ * @brief Time ordered ring of compressed frames
+ *
+ * Frames are kept as received (e.g. JPEG), so minutes of video take only as much memory as the payloads.
+ * Frames older than the window are dropped, as are the oldest frames when the history exceeds maxBytes.
+ */
+class FrameHistory
+{
+public:
+    /*!
+     * @brief Set how long frames are kept
+     * @param window Window (in milliseconds)
+     */
+    void setWindow(qint64 window);
+
+    /*!
+     * @brief Append frame
+     * @param time Time the frame was received (in milliseconds since epoch)
+     * @param payload Compressed frame
+     */
+    void append(qint64 time, QByteArray payload);
+
+    //! Number of frames
+    int count() const;
+
+    /*!
+     * @brief Frame by position
+     * @param i Position, 0 is the oldest frame
+     * @returns frame
+     */
+    const HistoryFrame &at(int i) const;
+
+    /*!
+     * @brief Find frame shown at given time
+     * @param time Time (in milliseconds since epoch)
+     * @returns position of the last frame received at or before the time, 0 if the time precedes history
+     */
+    int indexAt(qint64 time) const;
+
+    //! Size of stored payloads
+    qint64 size() const;
+
+    //! Maximum size of stored payloads
+    static constexpr qint64 maxBytes = 128 * 1024 * 1024;
+
+private:
+    //! Frames from the oldest
+    std::deque<HistoryFrame> frames;
+
+    //! How long frames are kept (in milliseconds)
+    qint64 window = 0;
+
+    //! Size of stored payloads
+    qint64 bytes = 0;
+
+    //! Id of the next frame
+    quint64 nextId = 0;
+};
+
+/*!
+ * @brief Decodes frames of history ahead of playback
+ *
+ * Playback requests the frames it is going to show, they are decoded in order on worker thread.
+ * Only the requested frames are held decoded, so playback does not keep decoded video in memory.
+ */
+class FramePrefetcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    /*!
+     * @brief Constructor
+     * @param pool Buffers frames are decoded into
+     * @param parent Parent object
+     */
+    FramePrefetcher(FramePool *pool, QObject *parent);
+
+    //! Destructor, waits for running worker
+    ~FramePrefetcher();
+
+    /*!
+     * @brief Set frames to decode, decoded frames that are not requested anymore are dropped
+     * @param frames Frames in the order they are going to be shown
+     * @param size Bounding size of decoded frames
+     */
+    void request(QVector<HistoryFrame> frames, QSize size);
+
+    /*!
+     * @brief Take decoded frame
+     * @param id Frame id
+     * @param image Decoded frame, null image if the payload is not an image
+     * @returns false if the frame was not decoded yet
+     */
+    bool take(quint64 id, QImage &image);
+
+    //! Drop all requested and decoded frames
+    void clear();
+
+signals:
+    /*!
+     * @brief Signal that requested frame was decoded
+     * @param id Frame id
+     */
+    void frameReady(quint64 id);
+
+private:
+    /*!
+     * @brief Store decoded frame and start the next one
+     * @param id Frame id
+     * @param image Decoded frame
+     */
+    void finish(quint64 id, QImage image);
+
+    //! Start worker for the first requested frame that is not decoded
+    void start();
+
+    /*!
+     * @brief Check whether frame is requested
+     * @param id Frame id
+     */
+    bool isWanted(quint64 id);
+
+    //! Buffers frames are decoded into
+    FramePool *pool;
+
+    //! Requested frames
+    QVector<HistoryFrame> wanted;
+
+    //! Decoded frames by id
+    QMap<quint64, QImage> decoded;
+
+    //! Bounding size of decoded frames
+    QSize targetSize;
+
+    //! Whether a worker is running
+    bool busy = false;
+
+    //! Pool that runs the worker
+    QThreadPool workers;
+};
+
+#endif
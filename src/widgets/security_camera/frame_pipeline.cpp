@@ -0,0 +1,154 @@
+/*!
+ * @file frame_pipeline.cpp
+ * @author Michal Šlesár (xslesa01)
+ * @author Erik Belko (xbelko02)
+ * @brief Implementation of FrameDecoder and FrameView
+ */
+
+#include "frame_pipeline.h"
+
+#include <QBuffer>
+#include <QPainter>
+#include <QMutexLocker>
+#include <QImageReader>
+
+QImage FramePool::acquire(QSize size)
+{
+    QMutexLocker locker(&mutex);
+
+    while(!buffers.isEmpty())
+    {
+        auto image = buffers.takeLast();
+        if(image.size() == size)
+            return image;
+    }
+
+    return QImage();
+}
+
+void FramePool::release(QImage image)
+{
+    if(image.isNull())
+        return;
+
+    QMutexLocker locker(&mutex);
+
+    if(buffers.count() < maxBuffers)
+        buffers.append(image);
+}
+
+FrameWorker::FrameWorker(FramePool *pool, QByteArray payload, QSize size, QObject *receiver, std::function<void(QImage)> callback) : 
+    pool(pool), payload(payload), size(size), receiver(receiver), callback(callback) {}
+
+void FrameWorker::run()
+{
+    QBuffer buffer;
+    buffer.setData(payload);
+    buffer.open(QIODevice::ReadOnly);
+
+    // JPEG is decoded directly at reduced resolution
+    QImageReader reader(&buffer);
+    auto imageSize = reader.size();
+    QImage image;
+
+    if(imageSize.isValid() && size.isValid())
+    {
+        auto scaledSize = imageSize.scaled(size, Qt::KeepAspectRatio).expandedTo(QSize(1, 1));
+        reader.setScaledSize(scaledSize);
+
+        // Reader writes into buffer of the same size and format instead of allocating new one
+        image = pool->acquire(scaledSize);
+    }
+
+    if(!reader.read(&image))
+        image = QImage();
+
+    // Formats without scaled decoding are scaled after decoding
+    if(!image.isNull() && size.isValid() && (image.width() > size.width() || image.height() > size.height()))
+        image = image.scaled(size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+
+    QMetaObject::invokeMethod(receiver, [callback = callback, image]() {
+        callback(image);
+    }, Qt::QueuedConnection);
+}
+
+FrameDecoder::FrameDecoder(FramePool *pool, QObject *parent) : QObject(parent), pool(pool)
+{
+    workers.setMaxThreadCount(1);
+}
+
+FrameDecoder::~FrameDecoder()
+{
+    workers.clear();
+    workers.waitForDone();
+}
+
+void FrameDecoder::submit(QByteArray payload)
+{
+    // Frame that was not started yet is replaced by the newer one
+    pending = payload;
+
+    if(!busy)
+        start();
+}
+
+void FrameDecoder::setTargetSize(QSize size)
+{
+    targetSize = size;
+}
+
+void FrameDecoder::start()
+{
+    if(pending.isNull())
+        return;
+
+    busy = true;
+    workers.start(new FrameWorker(pool, pending, targetSize, this, [this](QImage image) {
+        finish(image);
+    }));
+    pending = QByteArray();
+}
+
+void FrameDecoder::finish(QImage image)
+{
+    busy = false;
+    emit frameReady(image);
+    start();
+}
+
+FrameView::FrameView(FrameDecoder *decoder, FramePool *pool, QWidget *parent) : QWidget(parent), decoder(decoder), pool(pool)
+{
+    setMinimumSize(256, 144);
+    setAttribute(Qt::WA_OpaquePaintEvent);
+}
+
+void FrameView::setFrame(QImage image)
+{
+    // Previous frame is drawn no more, its buffer is reused for the next frame
+    pool->release(frame);
+    frame = image;
+    update();
+}
+
+void FrameView::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event);
+
+    QPainter painter(this);
+    painter.fillRect(rect(), Qt::black);
+
+    if(frame.isNull())
+        return;
+
+    auto size = frame.size().scaled(this->size(), Qt::KeepAspectRatio);
+    auto target = QRect(QPoint(0, 0), size);
+    target.moveCenter(rect().center());
+
+    painter.drawImage(target, frame);
+}
+
+void FrameView::resizeEvent(QResizeEvent *event)
+{
+    QWidget::resizeEvent(event);
+    decoder->setTargetSize(size());
+}
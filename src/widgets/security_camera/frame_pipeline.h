@@ -0,0 +1,204 @@
+/*!
+ * @file frame_pipeline.h
+ * @author Michal Šlesár (xslesa01)
+ * @author Erik Belko (xbelko02)
+ * @brief Decoding of camera frames for live view
+ */
+
+#ifndef E_FRAME_PIPELINE_H
+#define E_FRAME_PIPELINE_H
+
+#include <functional>
+
+#include <QSize>
+#include <QList>
+#include <QImage>
+#include <QMutex>
+#include <QObject>
+#include <QWidget>
+#include <QRunnable>
+#include <QByteArray>
+#include <QThreadPool>
+
+/*!
+ * @brief Pool of image buffers of one size
+ *
+ * Frames are decoded into released buffers, so a live view does not allocate a new buffer per frame.
+ * Buffers of other size are dropped, pool is used from worker and GUI thread.
+ */
+class FramePool
+{
+public:
+    /*!
+     * @brief Take buffer from pool
+     * @param size Size of buffer
+     * @returns pooled buffer, null image if there is no buffer of this size
+     */
+    QImage acquire(QSize size);
+
+    /*!
+     * @brief Return buffer to pool
+     * @param image Buffer that is no longer used
+     */
+    void release(QImage image);
+
+    //! Maximum number of kept buffers
+    static constexpr int maxBuffers = 3;
+
+private:
+    //! Free buffers
+    QList<QImage> buffers;
+
+    //! Guards buffers
+    QMutex mutex;
+};
+
+/*!
+ * @brief Decodes one frame on worker thread
+ *
+ * Decoded frame is passed to the callback on thread of the receiver.
+ */
+class FrameWorker : public QRunnable
+{
+public:
+    /*!
+     * @brief Constructor
+     * @param pool Buffers the frame is decoded into
+     * @param payload Compressed frame
+     * @param size Bounding size of decoded frame
+     * @param receiver Object the callback is called on, callback is dropped when it is destroyed
+     * @param callback Receives decoded frame, null image if the payload is not an image
+     */
+    FrameWorker(FramePool *pool, QByteArray payload, QSize size, QObject *receiver, std::function<void(QImage)> callback);
+
+    //! Decode frame
+    void run() override;
+
+private:
+    //! Buffers the frame is decoded into
+    FramePool *pool;
+
+    //! Compressed frame
+    QByteArray payload;
+
+    //! Bounding size of decoded frame
+    QSize size;
+
+    //! Object the callback is called on
+    QObject *receiver;
+
+    //! Receives decoded frame
+    std::function<void(QImage)> callback;
+};
+
+/*!
+ * @brief Decodes only the newest frame of camera
+ *
+ * At most one frame is decoded at a time. Frames that arrive meanwhile replace each other,
+ * so when decoding or rendering lags, intermediate frames are skipped and there is no backlog.
+ * Frames are decoded directly at the size they are shown at.
+ */
+class FrameDecoder : public QObject
+{
+    Q_OBJECT
+
+public:
+    /*!
+     * @brief Constructor
+     * @param pool Buffers decoded frames are written to, must outlive the decoder
+     * @param parent Parent object
+     */
+    FrameDecoder(FramePool *pool, QObject *parent);
+
+    //! Destructor, waits for running worker
+    ~FrameDecoder();
+
+    /*!
+     * @brief Decode frame, replaces frame that waits for decoding
+     * @param payload Compressed frame
+     */
+    void submit(QByteArray payload);
+
+    /*!
+     * @brief Set bounding size of decoded frames
+     * @param size Size
+     */
+    void setTargetSize(QSize size);
+
+signals:
+    /*!
+     * @brief Signal that frame was decoded
+     * @param image Decoded frame, null image if the payload is not an image
+     */
+    void frameReady(QImage image);
+
+private:
+    /*!
+     * @brief Deliver decoded frame and start the waiting one, called on thread of the decoder
+     * @param image Decoded frame
+     */
+    void finish(QImage image);
+
+    //! Start worker for waiting frame
+    void start();
+
+    //! Buffers decoded frames are written to
+    FramePool *pool;
+
+    //! Frame waiting for decoding
+    QByteArray pending;
+
+    //! Whether a worker is running
+    bool busy = false;
+
+    //! Bounding size of decoded frames
+    QSize targetSize;
+
+    //! Pool that runs the worker, one thread per decoder
+    QThreadPool workers;
+};
+
+/*!
+ * @brief Shows the last decoded frame
+ *
+ * Repaints are merged by Qt, so frames that arrive faster than display rate cost one paint.
+ * Replaced frames are returned to the pool they were decoded into.
+ */
+class FrameView : public QWidget
+{
+    Q_OBJECT
+
+public:
+    /*!
+     * @brief Constructor
+     * @param decoder Decoder the frames come from
+     * @param pool Buffers the frames were decoded into
+     * @param parent Parent widget
+     */
+    FrameView(FrameDecoder *decoder, FramePool *pool, QWidget *parent);
+
+    /*!
+     * @brief Show frame
+     * @param image Decoded frame
+     */
+    void setFrame(QImage image);
+
+protected:
+    //! Draw frame
+    void paintEvent(QPaintEvent *event) override;
+
+    //! Decode frames at the new size
+    void resizeEvent(QResizeEvent *event) override;
+
+private:
+    //! Decoder the frames come from
+    FrameDecoder *decoder;
+
+    //! Buffers the frames were decoded into
+    FramePool *pool;
+
+    //! Shown frame
+    QImage frame;
+};
+
+#endif
@@ -7,11 +7,16 @@
 
 #include "security_camera.h"
 
+#include <algorithm>
+
 #include <QString>
 #include <QPixmap>
+#include <QSlider>
 #include <QDateTime>
+#include <QComboBox>
 #include <QPushButton>
 #include <QJsonObject>
+#include <QSignalBlocker>
 
 #include "../../utils.h"
 #include "../../explorer.h"
@@ -20,9 +25,25 @@
 
 WidgetSecurityCamera::WidgetSecurityCamera(Explorer* explorer) : Widget(explorer) {}
 
+WidgetSecurityCamera::~WidgetSecurityCamera()
+{
+    // Children are deleted only after members, workers must not release buffers into destroyed pool
+    delete view;
+    delete prefetcher;
+    delete decoder;
+
+    explorer->chargeWidgetMemory(topic, -history.size());
+}
+
 void WidgetSecurityCamera::onShowImageButtonClicked()
 {
-    Utils::openImage(image, explorer);
+    auto payload = lastPayload;
+    if(reviewing && history.count() > 0)
+        payload = history.at(history.indexAt(position)).payload;
+
+    QPixmap image;
+    if(image.loadFromData(payload))
+        Utils::openImage(image, explorer);
 }
 
 void WidgetSecurityCamera::onRemoveButtonClicked()
@@ -30,10 +51,152 @@ void WidgetSecurityCamera::onRemoveButtonClicked()
     explorer->removeWidget(this);
 }
 
+void WidgetSecurityCamera::onPlayButtonClicked()
+{
+    if(playbackTimer->isActive())
+    {
+        playbackTimer->stop();
+        buttonPlay->setText("Play");
+        return;
+    }
+
+    // Playback from live view starts at the oldest frame
+    if(!reviewing)
+    {
+        startReview();
+        position = history.at(0).time;
+    }
+
+    playbackClock.start();
+    playbackTimer->start();
+    buttonPlay->setText("Pause");
+    showPosition();
+}
+
+void WidgetSecurityCamera::onLiveButtonClicked()
+{
+    playbackTimer->stop();
+    buttonPlay->setText("Play");
+    buttonLive->setEnabled(false);
+
+    reviewing = false;
+    shownId = noFrame;
+    prefetcher->clear();
+    updateSlider();
+
+    labelDate->setText(QDateTime::fromMSecsSinceEpoch(history.at(history.count() - 1).time).toString("HH:mm:ss"));
+    decoder->submit(lastPayload);
+}
+
+void WidgetSecurityCamera::onPositionChanged(int value)
+{
+    if(history.count() == 0)
+        return;
+
+    startReview();
+    position = history.at(0).time + value;
+    showPosition();
+}
+
+void WidgetSecurityCamera::onSpeedChanged(int index)
+{
+    speed = 1 << index;
+}
+
+void WidgetSecurityCamera::onPlaybackTimeout()
+{
+    position += playbackClock.restart() * speed;
+
+    // Playback caught up with the camera
+    if(position >= history.at(history.count() - 1).time)
+    {
+        onLiveButtonClicked();
+        return;
+    }
+
+    updateSlider();
+    showPosition();
+}
+
+void WidgetSecurityCamera::onLiveFrame(QImage image)
+{
+    // Frame decoded before the review started
+    if(reviewing)
+    {
+        pool.release(image);
+        return;
+    }
+
+    view->setFrame(image);
+}
+
+void WidgetSecurityCamera::onPrefetchedFrame([[maybe_unused]] quint64 id)
+{
+    if(reviewing)
+        showPosition();
+}
+
+void WidgetSecurityCamera::startReview()
+{
+    if(reviewing)
+        return;
+
+    reviewing = true;
+    buttonLive->setEnabled(true);
+}
+
+void WidgetSecurityCamera::showPosition()
+{
+    position = std::max(position, history.at(0).time);
+
+    auto index = history.indexAt(position);
+    auto &frame = history.at(index);
+
+    QImage image;
+    if(frame.id != shownId && prefetcher->take(frame.id, image))
+    {
+        view->setFrame(image);
+        shownId = frame.id;
+        labelDate->setText(QDateTime::fromMSecsSinceEpoch(frame.time).toString("HH:mm:ss"));
+    }
+
+    QVector<HistoryFrame> frames;
+    if(frame.id != shownId)
+        frames.append(frame);
+
+    // During playback the frames the next ticks are going to show are decoded ahead,
+    // at higher speed the frames between them are skipped
+    if(playbackTimer->isActive())
+    {
+        for(auto i = 1; i <= lookAhead; i++)
+        {
+            auto &next = history.at(history.indexAt(position + (qint64) i * playbackInterval * speed));
+            if(next.id != shownId && (frames.isEmpty() || frames.last().id != next.id))
+                frames.append(next);
+        }
+    }
+
+    prefetcher->request(frames, view->size());
+}
+
+void WidgetSecurityCamera::updateSlider()
+{
+    if(history.count() == 0)
+        return;
+
+    // Value is changed by playback, only user changes are handled
+    QSignalBlocker blocker(sliderPosition);
+
+    auto first = history.at(0).time;
+    sliderPosition->setRange(0, (int) (history.at(history.count() - 1).time - first));
+    sliderPosition->setValue(reviewing ? (int) (position - first) : sliderPosition->maximum());
+}
+
 bool WidgetSecurityCamera::Setup(QJsonObject data)
 {
     name = data.value("name").toString();
     topic = data.value("topic").toString();
+    historyLength = data.value("history").toInt(5);
     return true;
 }
 
@@ -47,6 +210,7 @@ bool WidgetSecurityCamera::Setup()
 
     topic = settings.topic->text();
     name = settings.name->text();
+    historyLength = settings.history->value();
 
     delete dialog;
     return result;
@@ -58,19 +222,45 @@ QJsonObject WidgetSecurityCamera::ExtractConfig()
     result.insert("widget", "SecurityCamera");
     result.insert("name", name);
     result.insert("topic", topic);
+    result.insert("history", historyLength);
     return result;
 }
 
-void WidgetSecurityCamera::messageReceived(QString topic, QVariant data, [[maybe_unused]] bool local)
+void WidgetSecurityCamera::messageReceived(QString topic, QByteArray payload, bool isImage, [[maybe_unused]] bool local)
 {
-    if(this->topic != topic || data.userType() != QMetaType::QPixmap)
+    if(this->topic != topic || !isImage || decoder == Q_NULLPTR)
         return;
 
-    image = qvariant_cast<QPixmap>(data);
+    auto now = QDateTime::currentMSecsSinceEpoch();
+
+    // Compressed history counts against the memory budget as the topic's own payloads
+    auto held = history.size();
+    lastPayload = payload;
+    history.append(now, payload);
+    explorer->chargeWidgetMemory(topic, history.size() - held);
+    updateSlider();
 
     labelStatus->setText("Working");
-    labelDate->setText(QDateTime::currentDateTime().toString("HH:mm:ss"));
     buttonShowImage->setEnabled(true);
+    buttonPlay->setEnabled(true);
+    sliderPosition->setEnabled(true);
+
+    // Frames keep being recorded while the history is reviewed
+    if(reviewing)
+        return;
+
+    labelDate->setText(QDateTime::fromMSecsSinceEpoch(now).toString("HH:mm:ss"));
+
+    // Frames of camera out of view are not decoded
+    if(!offscreen)
+        decoder->submit(payload);
+}
+
+void WidgetSecurityCamera::offscreenChanged()
+{
+    // Camera scrolled back into view shows the newest frame
+    if(!offscreen && !reviewing && !lastPayload.isNull())
+        decoder->submit(lastPayload);
 }
 
 bool WidgetSecurityCamera::Render()
@@ -94,11 +284,35 @@ bool WidgetSecurityCamera::Render()
         return false;
     }
 
+    if(historyLength <= 0)
+    {
+        explorer->setStatus("Camera history must be positive");
+        return false;
+    }
+
     setupUi(this);
 
     labelName->setText(name);
 
+    history.setWindow((qint64) historyLength * 60 * 1000);
+
+    decoder = new FrameDecoder(&pool, this);
+    prefetcher = new FramePrefetcher(&pool, this);
+    view = new FrameView(decoder, &pool, this);
+    layoutView->addWidget(view);
+
+    playbackTimer = new QTimer(this);
+    playbackTimer->setInterval(playbackInterval);
+
+    connect(decoder, &FrameDecoder::frameReady, this, &WidgetSecurityCamera::onLiveFrame);
+    connect(prefetcher, &FramePrefetcher::frameReady, this, &WidgetSecurityCamera::onPrefetchedFrame);
+    connect(playbackTimer, &QTimer::timeout, this, &WidgetSecurityCamera::onPlaybackTimeout);
+
     connect(buttonRemove, &QPushButton::clicked, this, &WidgetSecurityCamera::onRemoveButtonClicked);
     connect(buttonShowImage, &QPushButton::clicked, this, &WidgetSecurityCamera::onShowImageButtonClicked);
+    connect(buttonPlay, &QPushButton::clicked, this, &WidgetSecurityCamera::onPlayButtonClicked);
+    connect(buttonLive, &QPushButton::clicked, this, &WidgetSecurityCamera::onLiveButtonClicked);
+    connect(sliderPosition, &QSlider::valueChanged, this, &WidgetSecurityCamera::onPositionChanged);
+    connect(comboSpeed, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &WidgetSecurityCamera::onSpeedChanged);
     return true;
-}
\ No newline at end of file
+}
@@ -8,13 +8,20 @@
 #ifndef E_WIDGET_SECURITY_CAMERA_H
 #define E_WIDGET_SECURITY_CAMERA_H
 
+#include <limits>
+
 #include <QWidget>
+#include <QTimer>
+#include <QImage>
 #include <QString>
-#include <QPixmap>
+#include <QElapsedTimer>
+#include <QByteArray>
 #include <QVariant>
 #include <QJsonObject>
 
 #include "../widget.h"
+#include "frame_history.h"
+#include "frame_pipeline.h"
 
 #include "../../explorer.h"
 
@@ -26,7 +33,9 @@ class Explorer;
 /*! 
  * @brief Widget for getting images from security camera
  * 
- * This widget listens on provided topic and accepts all image messages
+ * This widget listens on provided topic and accepts all image messages.
+ * Live view shows only the newest frame, frames that arrive while the previous one is decoded are skipped.
+ * Last minutes of frames are kept compressed and can be scrubbed through or played back at higher speed.
  */
 class WidgetSecurityCamera : public Widget, public Ui::SecurityCameraWidget
 {
@@ -39,6 +48,9 @@ public:
      */
     WidgetSecurityCamera(Explorer* explorer);
 
+    //! Destructor, stops decoding before the pool is released and releases memory of history
+    ~WidgetSecurityCamera();
+
     /*!
      * @brief Setup widget when added to dashboard
      * @returns true if successful, false otherwise
@@ -64,6 +76,10 @@ public:
      */
     virtual QJsonObject ExtractConfig() override;
 
+protected:
+    //! Decode the newest frame when camera is scrolled back into view
+    virtual void offscreenChanged() override;
+
 private slots:
     //! This slot is called when show image button is clicked
     void onShowImageButtonClicked();
@@ -71,23 +87,111 @@ private slots:
     //! This slot is called when remove button is clicked
     void onRemoveButtonClicked();
 
+    //! This slot is called when play button is clicked, starts or pauses playback
+    void onPlayButtonClicked();
+
+    //! This slot is called when live button is clicked, returns from history to live view
+    void onLiveButtonClicked();
+
+    /*!
+     * @brief This slot is called when user moves the position slider
+     * @param value Position in history (in milliseconds from the oldest frame)
+     */
+    void onPositionChanged(int value);
+
+    /*!
+     * @brief This slot is called when playback speed is changed
+     * @param index Index of the speed, speed doubles with every index
+     */
+    void onSpeedChanged(int index);
+
+    //! This slot is called periodically during playback
+    void onPlaybackTimeout();
+
+    /*!
+     * @brief This slot is called when live frame is decoded
+     * @param image Decoded frame
+     */
+    void onLiveFrame(QImage image);
+
+    /*!
+     * @brief This slot is called when history frame is decoded
+     * @param id Frame id
+     */
+    void onPrefetchedFrame(quint64 id);
+
     /*!
      * @brief This slot is called when client receives new message
      * @param topic Topic
-     * @param data Image or string
+     * @param payload Raw payload
+     * @param isImage Whether the payload is image
      * @param local Whether the message was sent from us
      */
-    virtual void messageReceived(QString topic, QVariant data, bool local) override;
+    virtual void messageReceived(QString topic, QByteArray payload, bool isImage, bool local) override;
 
 private:
+    //! Switch from live view to history
+    void startReview();
+
+    //! Show history frame at the current position and decode the following ones
+    void showPosition();
+
+    //! Update range and value of the position slider
+    void updateSlider();
+
     //! Widget name
     QString name;
 
     //! Topic name
     QString topic;
 
-    //! Last image
-    QPixmap image;
+    //! Last compressed frame, decoded in full size only when shown
+    QByteArray lastPayload;
+
+    //! Buffers of decoded frames, shared by live view and playback
+    FramePool pool;
+
+    //! Decoder of live view frames
+    FrameDecoder *decoder = Q_NULLPTR;
+
+    //! Live view
+    FrameView *view = Q_NULLPTR;
+
+    //! How long frames are kept in history (in minutes)
+    int historyLength = 5;
+
+    //! Compressed frames of the last minutes
+    FrameHistory history;
+
+    //! Decoder of history frames
+    FramePrefetcher *prefetcher = Q_NULLPTR;
+
+    //! Advances playback
+    QTimer *playbackTimer = Q_NULLPTR;
+
+    //! Measures time between playback ticks
+    QElapsedTimer playbackClock;
+
+    //! Whether history is shown instead of live view
+    bool reviewing = false;
+
+    //! Shown time of history (in milliseconds since epoch)
+    qint64 position = 0;
+
+    //! Playback speed
+    int speed = 1;
+
+    //! Id of shown history frame
+    quint64 shownId = noFrame;
+
+    //! Id meaning that no history frame is shown
+    static constexpr quint64 noFrame = std::numeric_limits<quint64>::max();
+
+    //! Number of playback ticks decoded ahead
+    static constexpr int lookAhead = 8;
+
+    //! Interval of playback ticks (in milliseconds)
+    static constexpr int playbackInterval = 40;
 };
 
 #endif
\ No newline at end of file
@@ -41,7 +41,8 @@ bool WidgetThermostat::Setup(QJsonObject data)
 {
     name = data.value("name").toString();
     topic = data.value("topic").toString();
-    return true;
+    field = data.value("field").toString();
+    return fieldPath.compile(field);
 }
 
 bool WidgetThermostat::Setup()
@@ -54,8 +55,17 @@ bool WidgetThermostat::Setup()
 
     topic = settings.topic->text();
     name = settings.name->text();
+    field = settings.field->text();
 
     delete dialog;
+
+    // Path is compiled once, messages are only scanned for the field
+    if(result && !fieldPath.compile(field))
+    {
+        explorer->setStatus("Invalid JSON field");
+        return false;
+    }
+
     return result;
 }
 
@@ -65,23 +75,26 @@ QJsonObject WidgetThermostat::ExtractConfig()
     result.insert("widget", "Thermostat");
     result.insert("name", name);
     result.insert("topic", topic);
+    result.insert("field", field);
     return result;
 }
 
-void WidgetThermostat::messageReceived(QString topic, QVariant data, [[maybe_unused]] bool local)
+void WidgetThermostat::messageReceived(QString topic, QByteArray payload, bool isImage, [[maybe_unused]] bool local)
 {
-    if(this->topic != topic || data.userType() != QMetaType::QString)
+    QByteArray value;
+    if(this->topic != topic || isImage || !fieldPath.find(payload, value))
         return;
 
     bool isNumber;
-    auto number = qvariant_cast<QString>(data).toInt(&isNumber);
+    value = value.trimmed();
+    auto number = value.toDouble(&isNumber);
 
     if(!isNumber)
         return;
 
-    temperature = number;
+    temperature = qRound(number);
 
-    labelTemperature->setText(qvariant_cast<QString>(data) + " °C");
+    labelTemperature->setText(QString::fromUtf8(value) + " °C");
     labelDate->setText(QDateTime::currentDateTime().toString("HH:mm:ss"));
 }
 
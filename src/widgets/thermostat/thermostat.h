@@ -15,6 +15,7 @@
 #include <QJsonObject>
 
 #include "../widget.h"
+#include "../../json_path.h"
 
 #include "../../explorer.h"
 
@@ -77,10 +78,11 @@ private slots:
     /*!
      * @brief This slot is called when client receives new message
      * @param topic Topic
-     * @param data Image or string
+     * @param payload Raw payload
+     * @param isImage Whether the payload is image
      * @param local Whether the message was sent from us
      */
-    virtual void messageReceived(QString topic, QVariant data, bool local) override;
+    virtual void messageReceived(QString topic, QByteArray payload, bool isImage, bool local) override;
 
 private:
     //! Widget name
@@ -89,6 +91,12 @@ private:
     //! Topic name
     QString topic;
 
+    //! JSON path of the shown field, empty for the whole payload
+    QString field;
+
+    //! Compiled JSON path of the shown field
+    JsonPath fieldPath;
+
     //! Current temperature
     int temperature = 25;
 };
@@ -14,4 +14,15 @@ Widget::Widget(Explorer* explorer) : QWidget(explorer)
     this->explorer = explorer;
 
     connect(explorer, &Explorer::messageReceived, this, &Widget::messageReceived);
+}
+
+void Widget::setOffscreen(bool offscreen)
+{
+    if(this->offscreen == offscreen)
+        return;
+
+    // Updates of children are disabled too, enabling them again repaints the widget
+    this->offscreen = offscreen;
+    setUpdatesEnabled(!offscreen);
+    offscreenChanged();
 }
\ No newline at end of file
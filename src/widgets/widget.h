@@ -55,18 +55,33 @@ public:
      */
     virtual QJsonObject ExtractConfig() = 0;
 
+    /*!
+     * @brief Set whether widget is scrolled out of dashboard view
+     *
+     * Offscreen widget keeps receiving messages and updating its state, but it is not repainted.
+     * @param offscreen Whether widget is out of view
+     */
+    void setOffscreen(bool offscreen);
+
 private slots:
     /*!
      * @brief This slot is called when client receives new message
      * @param topic Topic
-     * @param data Image or string
+     * @param payload Raw payload
+     * @param isImage Whether the payload is image
      * @param local Whether the message was sent from us
      */
-    virtual void messageReceived(QString topic, QVariant data, bool local) = 0;
+    virtual void messageReceived(QString topic, QByteArray payload, bool isImage, bool local) = 0;
 
 protected:
+    //! This method is called when widget is scrolled out of view or back
+    virtual void offscreenChanged() {}
+
     //! Explorer instance
     Explorer* explorer;
+
+    //! Whether widget is scrolled out of dashboard view
+    bool offscreen = false;
 };
 
 #endif
\ No newline at end of file
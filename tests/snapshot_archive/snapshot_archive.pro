@@ -0,0 +1,20 @@
+TARGET = snapshot_archive_test
+CONFIG += c++17 testcase
+QT += core gui widgets testlib
+
+INCLUDEPATH += ../../src
+
+SOURCES += \
+    snapshot_archive_test.cpp \
+    ../../src/snapshot.cpp \
+    ../../src/utils.cpp \
+    ../../src/payload_viewer.cpp
+
+HEADERS += \
+    ../../src/snapshot.h \
+    ../../src/utils.h \
+    ../../src/payload_viewer.h
+
+FORMS += \
+    ../../src/preview_image.ui \
+    ../../src/preview_string.ui
@@ -0,0 +1,257 @@
+/*!
+ * @file snapshot_archive_test.cpp
+ * @author Michal Šlesár (xslesa01)
+ * @author Erik Belko (xbelko02)
+ * @brief Tests of Snapshot::readArchive on valid and malformed archives
+ */
+
+#include <climits>
+
+#include <QtTest>
+#include <QTemporaryFile>
+
+#include "snapshot.h"
+
+//! Layout values of test archive, valid archive unless a test changes them
+struct ArchiveLayout
+{
+    //! Topic paths
+    QList<QByteArray> paths = { "home/temp", "home/light" };
+
+    //! Payloads of topics
+    QList<QByteArray> payloads = { "21.5", "on" };
+
+    //! Base archive, written as delta when not empty
+    QByteArray base;
+
+    //! Overrides of footer and records, applied when non-negative
+    qint64 dictionaryOffset = -1;
+    qint64 indexOffset = -1;
+    qint64 count = -1;
+    qint64 baseLength = -1;
+    qint64 pathLength = -1;
+
+    //! Payload length written to the first record, applied when non-zero
+    quint64 payloadLength = 0;
+
+    //! Raw index offset, applied when non-zero, for values not representable by qint64
+    quint64 rawIndexOffset = 0;
+};
+
+/*!
+ * @brief Append little endian number
+ * @param buffer Target buffer
+ * @param value Number
+ * @param size Number of bytes
+ */
+static void appendNumber(QByteArray &buffer, quint64 value, int size)
+{
+    for(auto i = 0; i < size; i++)
+        buffer.append((char) ((value >> (8 * i)) & 0xFF));
+}
+
+/*!
+ * @brief Build archive bytes in the format written by SnapshotArchiveWorker
+ * @param layout Layout of archive
+ * @returns archive bytes
+ */
+static QByteArray buildArchive(const ArchiveLayout &layout)
+{
+    QByteArray buffer;
+    buffer.append(Snapshot::archiveMagic, 4);
+    appendNumber(buffer, Snapshot::archiveVersion, 4);
+
+    if(!layout.base.isEmpty())
+    {
+        appendNumber(buffer, layout.baseLength >= 0 ? layout.baseLength : layout.base.size(), 4);
+        buffer.append(layout.base);
+    }
+
+    quint64 dictionaryOffset = buffer.size();
+    for(auto i = 0; i < layout.paths.count(); i++)
+    {
+        appendNumber(buffer, i == 0 && layout.pathLength >= 0 ? layout.pathLength : layout.paths[i].size(), 4);
+        buffer.append(layout.paths[i]);
+    }
+
+    quint64 offset = buffer.size();
+    QByteArray index;
+    for(auto i = 0; i < layout.payloads.count(); i++)
+    {
+        appendNumber(index, offset, 8);
+        appendNumber(index, i == 0 && layout.payloadLength != 0 ? layout.payloadLength : layout.payloads[i].size(), 8);
+        appendNumber(index, 1000 + i, 8);
+        appendNumber(index, 1, 4);
+        appendNumber(index, 0, 4);
+
+        buffer.append(layout.payloads[i]);
+        offset += layout.payloads[i].size();
+    }
+
+    quint64 indexOffset = offset;
+    buffer.append(index);
+
+    if(layout.rawIndexOffset != 0)
+        indexOffset = layout.rawIndexOffset;
+    else if(layout.indexOffset >= 0)
+        indexOffset = layout.indexOffset;
+
+    appendNumber(buffer, layout.dictionaryOffset >= 0 ? layout.dictionaryOffset : dictionaryOffset, 8);
+    appendNumber(buffer, indexOffset, 8);
+    appendNumber(buffer, layout.count >= 0 ? layout.count : layout.paths.count(), 4);
+    appendNumber(buffer, layout.base.isEmpty() ? 0 : 1, 4);
+    buffer.append(Snapshot::archiveMagic, 4);
+    appendNumber(buffer, Snapshot::archiveVersion, 4);
+
+    return buffer;
+}
+
+/*!
+ * @brief Tests of archive reader
+ */
+class SnapshotArchiveTest : public QObject
+{
+    Q_OBJECT
+
+private:
+    /*!
+     * @brief Write archive bytes to temporary file and read them back
+     * @param bytes Archive bytes
+     * @param entries Entries read from archive
+     * @param base Base archive read from archive
+     * @returns result of Snapshot::readArchive
+     */
+    bool read(const QByteArray &bytes, QVector<SnapshotEntry> &entries, QString &base)
+    {
+        QTemporaryFile file;
+        if(!file.open() || file.write(bytes) != bytes.size() || !file.flush())
+            return false;
+
+        auto result = Snapshot::readArchive(&file, entries, base);
+
+        // Payloads point to the mapped file, copy them before it is closed
+        for(auto &entry : entries)
+            entry.payload = QByteArray(entry.payload.constData(), entry.payload.size());
+
+        return result;
+    }
+
+    /*!
+     * @brief Check that archive is rejected without entries
+     * @param layout Layout of archive
+     */
+    void expectRejected(const ArchiveLayout &layout)
+    {
+        QVector<SnapshotEntry> entries;
+        QString base;
+        QVERIFY(!read(buildArchive(layout), entries, base));
+        QVERIFY(entries.isEmpty());
+    }
+
+private slots:
+    //! Valid full archive is read back
+    void validArchive()
+    {
+        QVector<SnapshotEntry> entries;
+        QString base;
+        QVERIFY(read(buildArchive(ArchiveLayout()), entries, base));
+        QCOMPARE(entries.count(), 2);
+        QCOMPARE(entries[0].path, QString("home/temp"));
+        QCOMPARE(entries[0].payload, QByteArray("21.5"));
+        QCOMPARE(entries[1].payload, QByteArray("on"));
+        QVERIFY(base.isEmpty());
+    }
+
+    //! Valid delta archive is read back with its base
+    void validDelta()
+    {
+        ArchiveLayout layout;
+        layout.base = "previous.mqea";
+
+        QVector<SnapshotEntry> entries;
+        QString base;
+        QVERIFY(read(buildArchive(layout), entries, base));
+        QCOMPARE(base, QString("previous.mqea"));
+        QCOMPARE(entries.count(), 2);
+    }
+
+    //! File shorter than header and footer
+    void truncatedFile()
+    {
+        QVector<SnapshotEntry> entries;
+        QString base;
+        QVERIFY(!read(buildArchive(ArchiveLayout()).left(20), entries, base));
+    }
+
+    //! Index offset past the end of the file
+    void indexOffsetPastEnd()
+    {
+        ArchiveLayout layout;
+        layout.indexOffset = 1 << 20;
+        expectRejected(layout);
+    }
+
+    //! Index offset that wraps around when the index size is added to it
+    void indexOffsetWrapping()
+    {
+        ArchiveLayout layout;
+        auto size = (quint64) buildArchive(layout).size();
+        layout.count = 16;
+        layout.rawIndexOffset = size - (quint64) Snapshot::archiveFooterSize - 16 * (quint64) Snapshot::archiveIndexEntrySize;
+        expectRejected(layout);
+    }
+
+    //! More topics than index records that fit before the footer
+    void countTooLarge()
+    {
+        ArchiveLayout layout;
+        layout.count = 0xFFFFFFFF;
+        expectRejected(layout);
+    }
+
+    //! Dictionary starting after the index
+    void dictionaryAfterIndex()
+    {
+        ArchiveLayout layout;
+        auto bytes = buildArchive(layout);
+        layout.dictionaryOffset = bytes.size() - Snapshot::archiveFooterSize;
+        expectRejected(layout);
+    }
+
+    //! Topic path longer than the dictionary
+    void pathTooLong()
+    {
+        ArchiveLayout layout;
+        layout.pathLength = 0xFFFFFFFF;
+        expectRejected(layout);
+    }
+
+    //! Base name longer than the space before the dictionary
+    void baseTooLong()
+    {
+        ArchiveLayout layout;
+        layout.base = "previous.mqea";
+        layout.baseLength = 0x80000000;
+        expectRejected(layout);
+    }
+
+    //! Payload length that does not fit into QByteArray
+    void payloadTooLong()
+    {
+        ArchiveLayout layout;
+        layout.payloadLength = (quint64) INT_MAX + 1;
+        expectRejected(layout);
+    }
+
+    //! Payload length that wraps around when added to its offset
+    void payloadWrapping()
+    {
+        ArchiveLayout layout;
+        layout.payloadLength = ~(quint64) 0;
+        expectRejected(layout);
+    }
+};
+
+QTEST_MAIN(SnapshotArchiveTest)
+
+#include "snapshot_archive_test.moc"